@@ -0,0 +1,142 @@
+#include "bjson.h"
+#include "writer.h"
+
+using namespace json;
+
+namespace {
+
+    constexpr char magic[4] = { 'b', 'j', 's', 'n' };
+
+    template <typename T> void put(std::string& out, T const v) {
+        out.append(reinterpret_cast<char const*>(&v), sizeof(v));
+    }
+
+    template <typename T> void store(std::string& out, size_t const at, T const v) {
+        memcpy(&out[at], &v, sizeof(v));
+    }
+
+    // offsets and sizes are 32-bit, relative to the container
+    uint32_t offset(std::string const& out, size_t const at) {
+        size_t const ofs = out.size() - at;
+        if (ofs > UINT32_MAX)
+            throw std::length_error("bjson: container over 4GB");
+        return static_cast<uint32_t>(ofs);
+    }
+
+}
+
+bjson_t::bjson_t(std::string_view const src) {
+    if (src.size() >= header_size && !memcmp(src.data(), magic, sizeof(magic))
+        && load<uint32_t>(src.data() + 4) == version && load<uint64_t>(src.data() + 8) == src.size())
+        data = src;
+}
+
+bjson_t bjson_t::load_file(char const* path, unsigned const map) {
+    auto file = mapped_file_t::open(path, map);
+    if (!file)
+        return bjson_t();
+    bjson_t res(file->view());
+    if (res)
+        res.file = std::move(file);
+    return res;
+}
+
+std::string bjson_t::encode(doc_t const& doc) {
+    std::string out;
+    out.append(magic, sizeof(magic));
+    put(out, version);
+    put(out, uint64_t(0));
+    if (doc.root)
+        write(out, *doc.root);
+    store(out, 8, static_cast<uint64_t>(out.size()));
+    return out;
+}
+
+bool bjson_t::save(doc_t const& doc, char const* path) {
+    auto const bin = encode(doc);
+    FILE* f = fopen(path, "wb");
+    if (!f)
+        return false;
+    bool const ok = fwrite(bin.data(), 1, bin.size(), f) == bin.size();
+    return fclose(f) == 0 && ok;
+}
+
+void bjson_t::write_text(std::string& out, std::string_view const s) {
+    if (s.size() > UINT32_MAX)
+        throw std::length_error("bjson: string over 4GB");
+    put(out, static_cast<uint32_t>(s.size()));
+    out.append(s);
+}
+
+void bjson_t::write(std::string& out, value_t const& v) {
+    size_t const at = out.size();
+    if (auto const* arr = v.get_if_array()) {
+        uint32_t const n = static_cast<uint32_t>(arr->size());
+        out.push_back('[');
+        put(out, n);
+        put(out, uint32_t(0));
+        out.resize(out.size() + size_t(n) * sizeof(uint32_t));
+        for (uint32_t i = 0; i < n; i++) {
+            store(out, at + container_head + i * sizeof(uint32_t), offset(out, at));
+            write(out, (*arr)[i]);
+        }
+        store(out, at + 1 + sizeof(uint32_t), offset(out, at));
+    } else if (auto const* obj = v.get_if_object()) {
+        uint32_t const n = static_cast<uint32_t>(obj->size());
+        out.push_back('{');
+        put(out, n);
+        put(out, uint32_t(0));
+        out.resize(out.size() + size_t(n) * 2 * sizeof(uint32_t));
+        for (uint32_t i = 0; i < n; i++) {
+            auto const& p = (*obj)[i];
+            auto const name = p.get_name();
+            size_t const e = at + container_head + i * 2 * sizeof(uint32_t);
+            store(out, e, fnv1a_32_2(name.data(), name.size()));
+            store(out, e + sizeof(uint32_t), offset(out, at));
+            write_text(out, p.get_raw_name());
+            write(out, p.get_value());
+        }
+        store(out, at + 1 + sizeof(uint32_t), offset(out, at));
+    } else {
+        auto const raw = v.get_raw_str();
+        switch (v.get_type()) {
+        case value_t::type_t::boolean:
+            out.push_back(raw == "true" ? 't' : 'f');
+            break;
+        case value_t::type_t::string:
+            out.push_back('\"');
+            write_text(out, raw);
+            break;
+        case value_t::type_t::number: {
+            std::string formatted;
+            auto text = raw;
+            if (text.empty()) { // set<T>() keeps no text
+                writer_t(formatted, false).write(v);
+                text = formatted;
+            }
+            reader_t rd{ text };
+            number_t num;
+            doc_t::parse_number(rd, &num);
+            std::visit([&out](auto const n) {
+                using T = std::decay_t<decltype(n)>;
+                out.push_back(std::is_same_v<T, int64_t> ? 'i' : std::is_same_v<T, uint64_t> ? 'u' : 'd');
+                put(out, n);
+            }, num);
+            write_text(out, text);
+            break;
+        }
+        default:
+            out.push_back('n');
+        }
+    }
+}
+
+void bjson_t::serialize(FILE* f, bool const pretty) const {
+    if (auto const r = root())
+        writer_t(f, pretty).write(r);
+}
+
+void bjson_t::serialize(std::string& out, bool const pretty) const {
+    if (auto const r = root())
+        writer_t(out, pretty).write(r);
+}
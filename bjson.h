@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+#include "node.h"
+
+// binary snapshot of a doc: the reader works in place on the bytes (mmap), there is no parse pass on load
+// header = "bjsn" | uint32 version | uint64 total size, the root value follows (none for an empty doc)
+// value = tag + body, integers are little-endian and unaligned, offsets count from the container tag
+//   'n','t','f'      null, true, false
+//   'i','u','d'      int64_t, uint64_t, double decoded on write | uint32 length + raw text (exact round trip)
+//   '"'              uint32 length + raw text, keeps quotes and escapes
+//   '['              uint32 count | uint32 size | count * uint32 element offset | elements
+//   '{'              uint32 count | uint32 size | count * (uint32 fnv1a of the name, uint32 member offset) | members
+// member = uint32 length + raw name (quoted) followed by its value
+// a container is limited to 4GB, snapshots are trusted: the reader only checks the header
+
+namespace json {
+
+    class bjson_t {
+    public:
+        class node_t;
+
+        static constexpr uint32_t version = 1;
+
+        bjson_t() = default;
+        bjson_t(bjson_t&&) = default;
+        bjson_t(bjson_t const&) = delete;
+        explicit bjson_t(std::string_view const data); // referenced, not copied; empty if the header doesn't match
+        // the snapshot owns the mapping, empty on failure (see errno)
+        static bjson_t load_file(char const* path, unsigned const map = mapped_file_t::populate);
+
+        static std::string encode(doc_t const& doc);
+        static bool save(doc_t const& doc, char const* path);
+
+        explicit operator bool() const { return !data.empty(); }
+
+        node_t root() const;
+        node_t find(std::string_view const path) const;
+        node_t find(jpath_t::plan_t const& plan) const;
+
+        template <typename T> std::vector<T> get_array(std::string_view const path, bool const _explicit = true) const;
+
+        // pretty (tabs) or compact text through writer_t, like doc_t::serialize
+        void serialize(FILE* f, bool const pretty = true) const;
+        void serialize(std::string& out, bool const pretty = true) const;
+
+        size_t size() const { return data.size(); }
+
+    private:
+        static constexpr size_t header_size = 16;
+        static constexpr size_t container_head = 1 + 2 * sizeof(uint32_t); // tag, count, size
+
+        template <typename T> static T load(char const* p) { T v; memcpy(&v, p, sizeof(v)); return v; }
+        static std::string_view text(char const* p) { return std::string_view(p + sizeof(uint32_t), load<uint32_t>(p)); }
+
+        static void write(std::string& out, value_t const& v);
+        static void write_text(std::string& out, std::string_view const s);
+
+    private:
+        std::unique_ptr<mapped_file_t> file;
+        std::string_view data;
+    };
+
+    class bjson_t::node_t : public node_query_t<bjson_t::node_t> {
+    public:
+        class const_iterator {
+        public:
+            const_iterator(char const* c, uint32_t const i) : cont(c), idx(i) {}
+            node_t operator * () const;
+            const_iterator& operator ++ () { idx++; return *this; }
+            bool operator != (const_iterator const& it) const { return idx != it.idx; }
+            bool operator == (const_iterator const& it) const { return idx == it.idx; }
+            std::string_view name() const;
+
+        private:
+            char const* entry() const; // element offset or member (hash, offset)
+
+            char const* cont;
+            uint32_t idx;
+        };
+
+    public:
+        node_t() = default;
+
+        explicit operator bool() const { return p != nullptr; }
+        node_t const& operator * () const { return *this; }
+
+        bool is_null() const { return tag() == 'n'; }
+        bool is_bool() const { return tag() == 't' || tag() == 'f'; }
+        bool is_number() const { return tag() == 'i' || tag() == 'u' || tag() == 'd'; }
+        bool is_string() const { return tag() == '\"'; }
+        bool is_object() const { return tag() == '{'; }
+        bool is_array() const { return tag() == '['; }
+
+        size_t size() const { return is_array() || is_object() ? load<uint32_t>(p + 1) : 0; }
+        std::string_view get_raw_str() const;
+
+        template <typename T> T get(T const def = T()) const;
+
+        const_iterator begin() const { return const_iterator(p, 0); }
+        const_iterator end() const { return const_iterator(p, static_cast<uint32_t>(size())); }
+
+        using node_query_t<node_t>::operator (); // int, recs, range
+        node_t operator () (size_t const i) const;
+        node_t operator () (std::string_view const name) const;
+
+    private:
+        friend class bjson_t;
+        explicit node_t(char const* at) : p(at) {}
+
+        char tag() const { return p ? *p : '\0'; }
+
+    private:
+        char const* p{ nullptr };
+    };
+
+    inline bjson_t::node_t bjson_t::root() const { return data.size() > header_size ? node_t(data.data() + header_size) : node_t(); }
+    inline bjson_t::node_t bjson_t::find(std::string_view const path) const { return jpath_t::walk(root(), path); }
+    inline bjson_t::node_t bjson_t::find(jpath_t::plan_t const& plan) const { return jpath_t::run(root(), plan); }
+
+    inline char const* bjson_t::node_t::const_iterator::entry() const {
+        return cont + container_head + idx * (*cont == '{' ? 2 * sizeof(uint32_t) : sizeof(uint32_t));
+    }
+
+    inline bjson_t::node_t bjson_t::node_t::const_iterator::operator * () const {
+        if (*cont == '[')
+            return node_t(cont + load<uint32_t>(entry()));
+        char const* const m = cont + load<uint32_t>(entry() + sizeof(uint32_t));
+        return node_t(m + sizeof(uint32_t) + load<uint32_t>(m));
+    }
+
+    inline std::string_view bjson_t::node_t::const_iterator::name() const {
+        if (*cont != '{')
+            return {};
+        auto const r = text(cont + load<uint32_t>(entry() + sizeof(uint32_t)));
+        return r.size() >= 2 ? r.substr(1, r.size() - 2) : std::string_view();
+    }
+
+    inline std::string_view bjson_t::node_t::get_raw_str() const {
+        switch (tag()) {
+        case 'n': return "null";
+        case 't': return "true";
+        case 'f': return "false";
+        case '\"': return text(p + 1);
+        case 'i': case 'u': case 'd': return text(p + 1 + sizeof(uint64_t));
+        }
+        return {};
+    }
+
+    template <typename T> T bjson_t::node_t::get(T const def) const {
+        if constexpr (std::is_same_v<T, bool>)
+            return is_bool() ? tag() == 't' : def;
+        else if constexpr (std::is_same_v<T, std::string_view>) {
+            auto const src = get_raw_str();
+            return is_string() && src.size() >= 2 ? src.substr(1, src.size() - 2) : def;
+        } else if constexpr (std::is_arithmetic_v<T>) {
+            switch (tag()) { // decoded on write, get<> is a load
+            case 'i': return static_cast<T>(load<int64_t>(p + 1));
+            case 'u': return static_cast<T>(load<uint64_t>(p + 1));
+            case 'd': return static_cast<T>(load<double>(p + 1));
+            }
+            return def;
+        } else
+            return T(*this);
+    }
+
+    inline bjson_t::node_t bjson_t::node_t::operator () (size_t const i) const {
+        return is_array() && i < size() ? *const_iterator(p, static_cast<uint32_t>(i)) : node_t();
+    }
+
+    inline bjson_t::node_t bjson_t::node_t::operator () (std::string_view const name) const {
+        if (is_object()) {
+            uint32_t const hash = fnv1a_32_2(name.data(), name.size()); // the key table is scanned, names only on a hash hit
+            char const* e = p + container_head;
+            for (uint32_t i = 0, n = static_cast<uint32_t>(size()); i < n; i++, e += 2 * sizeof(uint32_t)) {
+                if (load<uint32_t>(e) == hash) {
+                    if (const_iterator it(p, i); it.name() == name)
+                        return *it;
+                }
+            }
+        } else if (is_array()) {
+            for (auto const v : *this) {
+                if (v.is_object())
+                    return v(name);
+            }
+        }
+        return node_t();
+    }
+
+    template <typename T> std::vector<T> bjson_t::get_array(std::string_view const path, bool const _explicit) const {
+        return find(path).template get_array<T>(_explicit);
+    }
+
+}
@@ -65,6 +65,15 @@ inline constexpr uint32_t fnv1a_32_2(void const* buf, size_t const len, uint32_t
     return hval;
 }
 
+// char overloads: no cast from void const*, so names and literals can be hashed in constant expressions
+inline constexpr uint32_t fnv1a_32_2(char const* buf, size_t const len, uint32_t hval = FNV_32_offset_basis) {
+    for (size_t i = 0; i < len; i++) {
+        hval ^= static_cast<uint8_t>(buf[i]);
+        hval *= FNV_32_prime;
+    }
+    return hval;
+}
+
 inline constexpr uint16_t fnv1_16(void const* buf, uint32_t hval = FNV_32_offset_basis) {
     uint32_t const _32 = fnv1_32(buf, hval);
     return static_cast<uint16_t>((_32 >> 16) ^ (_32 & 0xffff));
@@ -139,6 +148,14 @@ inline constexpr uint64_t fnv1a_64_2(void const* buf, size_t const len, uint64_t
     return hval;
 }
 
+inline constexpr uint64_t fnv1a_64_2(char const* buf, size_t const len, uint64_t hval = FNV_64_offset_basis) {
+    for (size_t i = 0; i < len; i++) {
+        hval ^= static_cast<uint8_t>(buf[i]);
+        hval *= FNV_64_prime;
+    }
+    return hval;
+}
+
 //constexpr inline auto operator"" _fnv1_16(const char* s, size_t sz) { return fnv1_16(s, sz); }
 //constexpr inline auto operator"" _fnv1_24(const char* s, size_t sz) { return fnv1_24(s, sz); }
 //constexpr inline auto operator"" _fnv1_32(const char* s, size_t sz) { return fnv1_32(s, sz); }
@@ -1,50 +1,114 @@
 #include "json.h"
+#include "writer.h"
 
-#include <array>
+#include <atomic>
 #include <charconv>
+#include <exception>
+#include <thread>
 
 using namespace json;
 
-std::pair<std::string, bool> json::unescape(std::string_view const sv) {
-    std::string s;
-    s.resize(sv.size());
-    size_t dst = 0;
+namespace {
+
+    int hex(char const ch) noexcept {
+        return ch >= '0' && ch <= '9' ? ch - '0' : ch >= 'a' && ch <= 'f' ? ch - 'a' + 10 : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10 : -1;
+    }
+
+    // 4 HEXDIG at s[pos]
+    bool hex4(std::string_view const s, size_t const pos, uint32_t& cp) noexcept {
+        if (pos + 4 > s.size())
+            return false;
+        cp = 0;
+        for (size_t i = pos; i < pos + 4; i++) {
+            int const h = hex(s[i]);
+            if (h < 0)
+                return false;
+            cp = cp << 4 | static_cast<uint32_t>(h);
+        }
+        return true;
+    }
+
+    size_t utf8(uint32_t const cp, char* const dst) noexcept {
+        if (cp < 0x80) {
+            dst[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800) {
+            dst[0] = static_cast<char>(0xC0 | cp >> 6);
+            dst[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if (cp < 0x10000) {
+            dst[0] = static_cast<char>(0xE0 | cp >> 12);
+            dst[1] = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            dst[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        dst[0] = static_cast<char>(0xF0 | cp >> 18);
+        dst[1] = static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+        dst[2] = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        dst[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 4;
+    }
+
+}
+
+size_t json::unescape_to(std::string_view const sv, char* const dst) noexcept {
+    size_t dst_size = 0;
     for (size_t src = 0; src < sv.size();) {
-        size_t end = sv.find('\\', src);
-        if (end == sv.npos) {
-            memcpy(s.data() + dst, sv.data() + src, sv.size() - src);
-            dst += sv.size() - src;
+        size_t const end = simd::find_char(sv.data(), src, sv.size(), '\\');
+        memcpy(dst + dst_size, sv.data() + src, end - src);
+        dst_size += end - src;
+        if (end == sv.size())
             break;
-        }
-        memcpy(s.data() + dst, sv.data() + src, end - src);
-        dst += end - src;
         src = end + 1; // skip '\\'
-        assert(src != sv.size());
         if (src == sv.size())
-            return { "%failed to unescape: char after '\\' expected%", false };
-        if (sv[src] == 'u') {
-            src++;
-            assert(src + 4 <= sv.size());
-            if (src + 4 > sv.size())
-                return { "%failed to unescape: 4 HEXDIG chars expected%", false };
-            wchar_t wch = 0;
-            for (size_t i = 4; i--; src++) {
-                if (!is_hex(sv[src]))
-                    return { "%failed to unescape: HEXDIG char expected%", false };
-                wchar_t const ch = sv[src]>='0'&&sv[src]<='9'?sv[src]-'0':10+(sv[src]>='A'&&sv[src]<='F'?sv[src]-'A':sv[src]-'a');
-                wch |= ch << (i * 4);
-            }
-            s[dst++] = static_cast<char>(wch);
-        } else {
-            constexpr std::array<char, 8> cvt{ '\"', '\\', '/', '\x08', '\x0C', '\n', '\r', '\t' };
-            size_t const idx = std::string_view("\"\\/bfnrt").find(sv[src++]);
-            if (idx == sv.npos)
-                return { "%failed to unescape: unknown escape char%", false };
-            s[dst++] = cvt[idx];
+            return std::string_view::npos;
+        switch (char const ch = sv[src++]) {
+        case '\"': case '\\': case '/': dst[dst_size++] = ch; break;
+        case 'b': dst[dst_size++] = '\b'; break;
+        case 'f': dst[dst_size++] = '\f'; break;
+        case 'n': dst[dst_size++] = '\n'; break;
+        case 'r': dst[dst_size++] = '\r'; break;
+        case 't': dst[dst_size++] = '\t'; break;
+        case 'u': {
+            uint32_t cp, low;
+            if (!hex4(sv, src, cp))
+                return std::string_view::npos;
+            src += 4;
+            if (cp >= 0xD800 && cp < 0xDC00) { // high surrogate: combine with the low one that must follow
+                if (src + 6 <= sv.size() && sv[src] == '\\' && sv[src + 1] == 'u' && hex4(sv, src + 2, low) && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    src += 6;
+                } else
+                    cp = 0xFFFD; // lone surrogates can't be encoded, U+FFFD like most decoders
+            } else if (cp >= 0xDC00 && cp < 0xE000)
+                cp = 0xFFFD;
+            dst_size += utf8(cp, dst + dst_size);
+            break;
+        }
+        default:
+            return std::string_view::npos;
         }
     }
-    s.resize(dst);
-    return { s, true };
+    return dst_size;
+}
+
+std::pair<std::string, bool> json::unescape(std::string_view const sv) {
+    std::string s(sv.size(), '\0');
+    size_t const size = unescape_to(sv, s.data());
+    if (size == std::string_view::npos)
+        return { "%failed to unescape: malformed escape sequence%", false };
+    s.resize(size);
+    return { std::move(s), true };
+}
+
+std::pair<std::string_view, bool> json::unescape(std::string_view const sv, std::pmr::memory_resource* mr) {
+    char* const dst = static_cast<char*>(mr->allocate(std::max<size_t>(sv.size(), 1), 1));
+    size_t const size = unescape_to(sv, dst);
+    if (size == std::string_view::npos)
+        return { std::string_view(), false };
+    return { std::string_view(dst, size), true };
 }
 
 std::string json::unescape(std::string_view s, bool escaped) {
@@ -52,25 +116,113 @@ std::string json::unescape(std::string_view s, bool escaped) {
 }
 
 std::string json::escape(std::string_view s) {
-    return std::string(s); // todo: implement
+    std::string res;
+    res.reserve(s.size() + s.size() / 8);
+    escape(s, [&res](std::string_view const run) { res.append(run); });
+    return res;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void doc_t::makeError(std::string_view error, reader_t const& reader) const {
-    throw std::exception(std::string(error).c_str());
+void doc_t::makeError(errc_t const code, char const* error, reader_t& rd) {
+    rd.fail(code, error);
+}
+
+void doc_t::throwError(reader_t const& rd) {
+    auto const& err = rd.error();
+    auto const [line, column] = rd.location(err.offset);
+    std::string const msg = std::string(err.what) + " at line " + std::to_string(line) + ", column " + std::to_string(column) + " (offset " + std::to_string(err.offset) + ")";
+    throw std::runtime_error(msg);
+}
+
+result_t doc_t::parse(std::string_view const src, options_t const& opt) {
+    result_t res;
+    res.error = res.doc.try_load(src, opt);
+    return res;
 }
 
-std::pair<bool, std::unique_ptr<value_t>> doc_t::parse(std::string_view data, bool const local) {
-    reader_t rd{ data };
+result_t doc_t::load_file(char const* path, options_t const& opt, unsigned const map) {
+    result_t res;
+    auto file = mapped_file_t::open(path, map);
+    if (!file) {
+        res.error = { errc_t::io, 0, "can't open or map the file" };
+        return res;
+    }
+    res.error = res.doc.try_load(file->view(), opt);
+    if (!res.error && !opt.local) // string views point into the mapping
+        res.doc.file = std::move(file);
+    return res;
+}
+
+// sets up the arena(s), returns the text to parse
+std::string_view doc_t::prepare(std::string_view const data, options_t const& opt) {
+    prescan = 0;
+    if (opt.lazy) { // the doc itself only holds the root, the containers go to the lazy_t arena
+        lazy = std::make_unique<lazy_t>(data, opt);
+        owner = lazy.get();
+        arena = make_arena(1024, opt.upstream);
+        return lazy->text;
+    }
+    if (opt.upstream) // shared upstream (batch/thread arena): no point in padding small records
+        arena = make_arena(data.size() * 2 + 64, opt.upstream);
+    else
+        arena = make_arena(std::max<size_t>(data.size(), 4096));
+    return data;
+}
+
+void doc_t::load(std::string_view const data, options_t const& opt) {
+    reader_t rd{ prepare(data, opt) };
+    if (auto [ok, v] = parse_root(rd, opt); ok)
+        root = std::move(v);
+    else
+        throwError(rd);
+}
+
+parse_error_t doc_t::try_load(std::string_view const data, options_t const& opt) {
+    reader_t rd{ prepare(data, opt) };
+    if (auto [ok, v] = parse_root(rd, opt); ok)
+        root = std::move(v);
+    else {
+        shards.clear();
+        names.release(); // lives in the arena
+        arena.reset();
+        owner = nullptr;
+        lazy.reset();
+    }
+    return rd.error();
+}
+
+std::pair<bool, node_ptr<value_t>> doc_t::parse_root(reader_t& rd, options_t const& opt) {
+    if (!check_utf8(rd, opt))
+        return { false, nullptr };
     parse_ws(rd);
-    auto [res, val] = parse_value(rd, local);
+    auto [res, val] = parse_value(rd, opt);
+    if (!res)
+        makeError(errc_t::value, "value expected", rd);
     parse_ws(rd);
-    return { res, std::move(val) };
+    if (!rd.done())
+        makeError(errc_t::trailing, "unexpected characters after the root value", rd);
+    if (rd.failed()) {
+        val.release(); // arena memory, dropped with the arena
+        return { false, nullptr };
+    }
+    return { true, std::move(val) };
+}
+
+// separate pass over the whole input, the parser itself never looks at bytes >= 0x80
+bool doc_t::check_utf8(reader_t& rd, options_t const& opt) {
+    if (!opt.utf8)
+        return true;
+    if (size_t const bad = simd::validate_utf8(rd.get_base_ptr(), rd.size()); bad < rd.size()) {
+        rd.set_position(bad);
+        makeError(errc_t::utf8, "invalid UTF-8 sequence", rd);
+        return false;
+    }
+    return true;
 }
 
 bool doc_t::parse_ws(reader_t& rd) {
-    rd.skip_while(is_ws);
+    rd.skip_ws();
     return true;
 }
 
@@ -111,20 +263,24 @@ std::pair<bool, std::string_view> doc_t::parse_bool(reader_t& rd) {
     return {};
 }
 
-std::pair<bool, std::string_view> doc_t::parse_number(reader_t& rd) {
+std::pair<bool, std::string_view> doc_t::parse_number(reader_t& rd, number_t* num) {
     auto const start = rd.position();
-    rd.skip('-');
+    bool const negative = rd.skip('-');
+    auto const intStart = rd.position();
     if (!rd.skip('0')) {
         rd.skip(is_digit1_9);
-        rd.skip_while(is_digit);
+        rd.skip_digits();
     }
+    auto const intEnd = rd.position();
+    if (negative && intStart == intEnd)
+        makeError(errc_t::number, "int digit expected", rd);
 
     bool hasFrac = false;
     if (rd.has('.')) {
         rd.read();
         if (!rd.has(is_digit))
-            makeError("frac digit expected", rd);
-        rd.skip_while(is_digit);
+            makeError(errc_t::number, "frac digit expected", rd);
+        rd.skip_digits();
         hasFrac = true;
     }
 
@@ -133,15 +289,35 @@ std::pair<bool, std::string_view> doc_t::parse_number(reader_t& rd) {
         rd.read();
         if (!rd.skip('-')) rd.skip('+');
         if (!rd.has(is_digit))
-            makeError("exp digit expected", rd);
-        rd.skip_while(is_digit);
+            makeError(errc_t::number, "exp digit expected", rd);
+        rd.skip_digits();
         hasExp = true;
     }
 
     if (rd.position() == start)
         return {};
 
-    return { true, std::string_view(rd.get_base_ptr(start), rd.position() - start) };
+    std::string_view const text(rd.get_base_ptr(start), rd.position() - start);
+    if (num) {
+        // up to 20 int digits fit uint64_t unless overflow, frac/exp/larger go to double
+        bool exact = !hasFrac && !hasExp && intEnd - intStart <= 20;
+        uint64_t m = 0;
+        for (char const* p = rd.get_base_ptr(intStart), *e = rd.get_base_ptr(intEnd); exact && p < e; p++) {
+            uint64_t const d = static_cast<uint64_t>(*p - '0');
+            exact = m <= (UINT64_MAX - d) / 10;
+            m = m * 10 + d;
+        }
+        if (exact && !negative)
+            *num = m <= static_cast<uint64_t>(INT64_MAX) ? number_t(static_cast<int64_t>(m)) : number_t(m);
+        else if (exact && m && m <= static_cast<uint64_t>(INT64_MAX) + 1) // -0 stays double
+            *num = static_cast<int64_t>(0 - m);
+        else {
+            double d = 0;
+            parse_double(text.data(), text.data() + text.size(), d);
+            *num = d;
+        }
+    }
+    return { true, text };
 }
 
 std::tuple<bool, std::string_view, bool> doc_t::parse_string(reader_t& rd) {
@@ -150,185 +326,421 @@ std::tuple<bool, std::string_view, bool> doc_t::parse_string(reader_t& rd) {
         return {};
     bool escaped = false;
     while (true) {
-        rd.skip_until([](char const ch) { return ch == '\"' || ch == '\\'; });
-        if (rd.has('\"'))
+        rd.skip_to_quote_or_backslash();
+        if (rd.done() || rd.has('\"'))
             break;
         if (rd.skip('\\')) {
             escaped = true;
             if (rd.skip('u')) {
                 for (size_t i = 4; i--; ) {
                     if (!rd.skip(is_hex))
-                        makeError("parseString: hex symbol expected", rd);
+                        makeError(errc_t::string, "parseString: hex symbol expected", rd);
                 }
             }
             else if (!rd.skip(is_escaped)) {
-                makeError("parseString: escaped symbol expected", rd);
+                makeError(errc_t::string, "parseString: escaped symbol expected", rd);
             }
         }
     }
     if (!rd.skip('\"'))
-        makeError("Document::parseString", rd);
+        makeError(errc_t::string, "parseString: '\"' expected", rd);
     std::string_view s(rd.get_base_ptr(start), rd.position() - start);
     return { true, s, escaped };
 }
 
-std::pair<bool, std::unique_ptr<value_t>> doc_t::parse_value(reader_t& rd, bool const local) {
+std::pair<bool, node_ptr<value_t>> doc_t::parse_value(reader_t& rd, options_t const& opt) {
+    auto* const mr = arena.get();
+    bool const local = opt.local;
     parse_ws(rd);
     if (auto [hasNull, source] = parse_null(rd); hasNull)
-        return { true, std::make_unique<value_t>(value_t::type_t::null, source) };
+        return { true, make_node<value_t>(mr, value_t::type_t::null, source) };
     if (auto [hasBool, source] = parse_bool(rd); hasBool)
-        return { true, std::make_unique<value_t>(value_t::type_t::boolean, source) };
-    if (auto [hasNumber, source] = parse_number(rd); hasNumber)
-        return { true, std::make_unique<value_t>(value_t::type_t::number, source, false, local) };
+        return { true, make_node<value_t>(mr, value_t::type_t::boolean, source) };
+    if (owner && (rd.has('[') || rd.has('{'))) { // lazy: only the extent
+        auto const type = rd.has('[') ? value_t::type_t::array : value_t::type_t::object;
+        size_t const start = rd.position();
+        if (size_t const end = simd::match(rd.get_base_ptr(), start, rd.size(), [](size_t const) {}); end) {
+            rd.set_position(end);
+            return { true, make_node<value_t>(mr, type, rd.substr(start, end - start), owner) };
+        }
+        rd.set_position(rd.size());
+        makeError(errc_t::bracket, "unbalanced brackets", rd);
+        return {};
+    }
+    if (opt.numbers) {
+        number_t num;
+        if (auto [hasNumber, source] = parse_number(rd, &num); hasNumber)
+            return { true, make_node<value_t>(mr, local ? arena_str(mr, source) : source, num) };
+    } else if (auto [hasNumber, source] = parse_number(rd); hasNumber)
+        return { true, make_node<value_t>(mr, value_t::type_t::number, local ? arena_str(mr, source) : source, false) };
     if (auto [hasString, source, escaped] = parse_string(rd); hasString)
-        return { true, std::make_unique<value_t>(value_t::type_t::string, source, escaped, local) };
-    if (auto [hasArray, aVal] = parse_array(rd, local); hasArray)
-        return { true, std::make_unique<value_t>(std::move(aVal)) };
-    if (auto [hasObject, oVal] = parse_object(rd, local); hasObject)
-        return { true, std::make_unique<value_t>(std::move(oVal)) };
+        return { true, make_node<value_t>(mr, value_t::type_t::string, local ? arena_str(mr, source) : source, escaped) };
+    if (auto [hasArray, aVal] = parse_array(rd, opt); hasArray)
+        return { true, make_node<value_t>(mr, std::move(aVal)) };
+    if (auto [hasObject, oVal] = parse_object(rd, opt); hasObject)
+        return { true, make_node<value_t>(mr, std::move(oVal)) };
     parse_ws(rd);
     return {};
 }
 
-std::pair<bool, std::unique_ptr<array_t>> doc_t::parse_array(reader_t& rd, bool const local) {
+std::pair<bool, node_ptr<array_t>> doc_t::parse_array(reader_t& rd, options_t const& opt) {
     parse_ws(rd);
     if (!rd.skip('['))
         return { false, nullptr };
     parse_ws(rd);
 
-    auto array = std::make_unique<array_t>();
-    for (auto res = parse_value(rd, local); res.first; res = parse_value(rd, local)) {
-        array->add(std::move(res.second));
-        if (!parse_comma(rd))
-            break;
+    auto array = make_node<array_t>(arena.get(), arena.get());
+    options_t sub = opt;
+    if (opt.threads == 1 || !parse_parallel(rd, opt, array.get(), nullptr, sub)) {
+        for (auto res = parse_value(rd, sub); res.first; res = parse_value(rd, sub)) {
+            array->add(std::move(res.second));
+            if (!parse_comma(rd))
+                break;
+        }
     }
 
     parse_ws(rd);
     if (!rd.skip(']'))
-        makeError("parseArray: ']' expected", rd);
+        makeError(errc_t::bracket, "parseArray: ']' expected", rd);
     parse_ws(rd);
 
     return { true, std::move(array) };
 }
 
-std::pair<bool, pair_t> doc_t::parse_member(reader_t& rd, bool const local) {
+std::pair<bool, pair_t> doc_t::parse_member(reader_t& rd, options_t const& opt) {
     auto [hasName, name, escaped] = parse_string(rd);
     if (!hasName)
         return { false, pair_t() };
 
     parse_ws(rd);
     if (!rd.skip(':'))
-        makeError("parseMember: ':' expected", rd);
+        makeError(errc_t::colon, "parseMember: ':' expected", rd);
     parse_ws(rd);
 
-    auto [hasValue, value] = parse_value(rd, local);
+    auto [hasValue, value] = parse_value(rd, opt);
     if (!hasValue)
-        makeError("parseMember: 'value' expected", rd);
+        makeError(errc_t::value, "parseMember: 'value' expected", rd);
 
-    return { true, pair_t(name, std::move(value), local) };
+    return { true, pair_t(intern(name, opt.local), std::move(value)) };
 }
 
-std::pair<bool, std::unique_ptr<object_t>> doc_t::parse_object(reader_t& rd, bool const local) {
+std::pair<bool, node_ptr<object_t>> doc_t::parse_object(reader_t& rd, options_t const& opt) {
     parse_ws(rd);
     if (!rd.skip('{'))
         return { false, nullptr };
     parse_ws(rd);
 
-    auto object = std::make_unique<object_t>();
-    for (auto res = parse_member(rd, local); res.first; res = parse_member(rd, local)) {
-        object->add(std::move(res.second));
-        if (!parse_comma(rd))
-            break;
+    auto object = make_node<object_t>(arena.get(), arena.get());
+    options_t sub = opt;
+    if (opt.threads == 1 || !parse_parallel(rd, opt, nullptr, object.get(), sub)) {
+        for (auto res = parse_member(rd, sub); res.first; res = parse_member(rd, sub)) {
+            object->add(std::move(res.second));
+            if (!parse_comma(rd))
+                break;
+        }
     }
 
     parse_ws(rd);
     if (!rd.skip('}'))
-        makeError("parseObject: '}' expected", rd);
+        makeError(errc_t::bracket, "parseObject: '}' expected", rd);
     parse_ws(rd);
     return { true, std::move(object) };
 }
 
-void doc_t::serialize(FILE* f) {
-    std::string indent;
-    serialize(f, indent, *root.get());
+namespace {
+    // arena of a parallel parse worker, set up on the calling thread: upstream (a batch arena) is not shared
+    // between threads, so only the first block is carved from it, a part outgrowing it continues on the heap
+    arena_ptr make_shard(size_t const size, std::pmr::memory_resource* const upstream) {
+        if (!upstream)
+            return make_arena(std::max<size_t>(size, 4096));
+        size_t const block = size * 2 + 64; // like prepare()
+        void* const p = upstream->allocate(sizeof(arena_t), alignof(arena_t));
+        void* const buf = upstream->allocate(block, alignof(std::max_align_t));
+        return arena_ptr(new (p) arena_t(buf, block, std::pmr::new_delete_resource()), arena_free_t{ false });
+    }
+
+    // the open char of the container whose elements start at rd, only ws lies in between
+    size_t opening(reader_t const& rd) {
+        size_t open = rd.position();
+        while (is_ws(rd.get_base_ptr()[--open]));
+        return open;
+    }
 }
 
-void doc_t::serialize(FILE* f, std::string indent, std::string_view const value) {
-    fwrite(value.data(), value.size(), 1, f);
+// structural pre-pass over the container whose open char was just read (simd::match):
+// [begin, end) of every element (begin past the leading ws, end at its ',' or the close char) and the close position
+bool doc_t::split(reader_t const& rd, char const close, std::vector<std::pair<size_t, size_t>>& items, size_t& end) {
+    char const* const data = rd.get_base_ptr();
+    size_t const size = rd.size();
+    size_t begin = rd.position();
+    size_t const stop = simd::match(data, opening(rd), size, [&](size_t const comma) {
+        items.emplace_back(begin, comma);
+        begin = comma + 1;
+    });
+    if (!stop || data[stop - 1] != close)
+        return false;
+    end = stop - 1;
+    items.emplace_back(begin, end);
+    for (auto& [first, last] : items) {
+        first = simd::skip_ws(data, first, last);
+        if (first == last && &first != &items.back().first)
+            return false; // empty element
+    }
+    if (items.back().first == items.back().second)
+        items.pop_back(); // empty container or trailing comma
+    return true;
+}
+
+// parses the elements of a large container on worker threads, each into its own arena (kept in shards)
+// false: parse sequentially with `sub` (threads = 1 once the container is too small to be worth a split)
+bool doc_t::parse_parallel(reader_t& rd, options_t const& opt, array_t* array, object_t* object, options_t& sub) {
+    unsigned const threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    if (threads < 2) {
+        sub.threads = 1;
+        return false;
+    }
+    // look at the first parallel_bytes only: a container closing there is small, one with few elements there
+    // has large ones, they are split instead (a full pre-pass per nesting level would rescan the same bytes);
+    // the windows of such nested containers overlap, all of them together look at no more than the text once
+    if (prescan >= rd.size()) {
+        sub.threads = 1;
+        return false;
+    }
+    size_t const open = opening(rd), window = std::min(rd.size(), rd.position() + parallel_bytes);
+    prescan += window - open;
+    size_t commas = 0;
+    if (simd::match(rd.get_base_ptr(), open, window, [&](size_t const) { commas++; })) {
+        sub.threads = 1;
+        return false;
+    }
+    if (commas < size_t(threads) * 2)
+        return false;
+
+    std::vector<std::pair<size_t, size_t>> items;
+    size_t end = 0;
+    if (!split(rd, array ? ']' : '}', items, end)) {
+        sub.threads = 1; // malformed, the sequential parse reports it
+        return false;
+    }
+    if (items.size() < size_t(threads) * 2)
+        return false; // few large elements, split them instead
+
+    struct part_t {
+        doc_t doc; // worker arena, must outlive values/pairs
+        std::vector<node_ptr<value_t>> values;
+        std::vector<pair_t> pairs;
+        parse_error_t err;
+    };
+    size_t const count = std::min(items.size(), size_t(threads) * 8);
+    std::vector<part_t> parts(count);
+    options_t seq = opt;
+    seq.threads = 1;
+    std::atomic<size_t> next{ 0 };
+    std::string_view const data(rd.get_base_ptr(), rd.size());
+
+    for (size_t c = 0; c < count; c++) {
+        size_t const first = items.size() * c / count, last = items.size() * (c + 1) / count;
+        parts[c].doc.arena = make_shard(items[last - 1].second - items[first].first, opt.upstream);
+    }
+
+    std::mutex guard;
+    std::exception_ptr failed; // first worker exception (bad_alloc, length_error), rethrown once all are joined
+    auto const fail = [&] {
+        std::lock_guard<std::mutex> lk(guard);
+        if (!failed)
+            failed = std::current_exception();
+        next = count; // the others stop at their next part
+    };
+
+    auto worker = [&] {
+        try {
+            for (size_t c; (c = next++) < count; ) {
+                auto& part = parts[c];
+                size_t const first = items.size() * c / count, last = items.size() * (c + 1) / count;
+                reader_t prd{ data };
+                for (size_t i = first; i < last && !prd.failed(); i++) {
+                    prd.set_position(items[i].first);
+                    bool ok = false;
+                    if (array) {
+                        auto [hasValue, v] = part.doc.parse_value(prd, seq);
+                        if ((ok = hasValue))
+                            part.values.push_back(std::move(v));
+                    } else {
+                        auto [hasMember, m] = part.doc.parse_member(prd, seq);
+                        if ((ok = hasMember))
+                            part.pairs.push_back(std::move(m));
+                    }
+                    parse_ws(prd);
+                    if (!ok || prd.position() != items[i].second)
+                        makeError(errc_t::value, array ? "parseArray: value expected" : "parseObject: member expected", prd);
+                }
+                part.err = prd.error();
+            }
+        } catch (...) {
+            fail();
+        }
+    };
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned t = 1; t < threads; t++)
+            workers.emplace_back(worker);
+    } catch (...) { // no thread (system_error): the started ones are joined, then it is rethrown
+        fail();
+    }
+    worker();
+    for (auto& w : workers)
+        w.join();
+    if (failed)
+        std::rethrow_exception(failed);
+
+    for (auto const& part : parts) {
+        if (part.err) {
+            rd.set_position(part.err.offset);
+            makeError(part.err.code, part.err.what, rd);
+            return true;
+        }
+    }
+    for (auto& part : parts) {
+        for (auto& v : part.values)
+            array->add(std::move(v));
+        for (auto& m : part.pairs)
+            object->add(std::move(m));
+        shards.push_back(std::move(part.doc.arena));
+    }
+    rd.set_position(end);
+    return true;
 }
 
-void doc_t::serialize(FILE* f, std::string indent, bool const value) {
-    fprintf(f, "%s", (value ? "true" : "false"));
+lazy_t::lazy_t(std::string_view const src, options_t const& o) : opt{ o } {
+    parser.arena = make_arena(std::max<size_t>(src.size() / 2, 4096), o.upstream);
+    parser.owner = this;
+    text = opt.local ? arena_str(parser.arena.get(), src) : src;
+    opt.local = false; // text stays, views into it are enough
+    opt.threads = 1;
 }
 
-void doc_t::serialize(FILE* f, std::string indent, value_t const& value, bool const skipIndent) {
-    if (!skipIndent)
-        fprintf(f, "%s", indent.c_str());
-    if (value.is_object())
-        serialize(f, indent, *value.get_if_object());
-    else if (value.is_array())
-        serialize(f, indent, *value.get_if_array());
-    else
-        serialize(f, indent, value.get_raw_str());
+void lazy_t::load(value_t const& v) {
+    reader_t rd{ text };
+    parse(v, rd);
+    if (rd.failed())
+        doc_t::throwError(rd);
 }
 
-void doc_t::serialize(FILE* f, std::string indent, pair_t const& pair) {
-    fprintf(f, "%s", indent.c_str());
-    serialize(f, indent, pair.get_raw_name());
-    fprintf(f, ": ");
-    serialize(f, indent, pair.get_value(), true);
+parse_error_t lazy_t::try_load(value_t const& v) {
+    reader_t rd{ text };
+    parse(v, rd);
+    return rd.error();
 }
 
-void doc_t::serialize(FILE* f, std::string indent, object_t const& object) {
-    fprintf(f, "{");
-    if (!object.size()) {
-        fprintf(f, "}");
-        return;
+void lazy_t::parse(value_t const& v, reader_t& rd) {
+    std::lock_guard<std::mutex> lock(locker);
+    if (!v.is_lazy())
+        return; // built by another thread meanwhile
+    rd.set_position(static_cast<size_t>(v.source.data() - text.data()));
+    if (v.is_array()) {
+        if (auto [ok, arr] = parser.parse_array(rd, opt); ok && !rd.failed())
+            v.value = std::move(arr);
+    } else if (auto [ok, obj] = parser.parse_object(rd, opt); ok && !rd.failed()) {
+        v.value = std::move(obj);
     }
-    fprintf(f, "\n");
-    for (size_t i = 0; i < object.size(); i++) {
-        if (i) fprintf(f, ",\n");
-        serialize(f, indent + "\t", object[i]);
-    }
-    fprintf(f, "\n%s}", indent.c_str());
 }
 
-void doc_t::serialize(FILE* f, std::string indent, array_t const& array) {
-    fprintf(f, "[");
-    if (!array.size()) {
-        fprintf(f, "]");
-        return;
-    }
+void doc_t::serialize(FILE* f, bool const pretty) const {
+    if (root)
+        writer_t(f, pretty).write(*root);
+}
 
-    bool skipIndent = false;
-    if (array.size()) {
-        skipIndent = true;
-        if (array[0].is_object() || array[0].is_array())
-            skipIndent = false;
-        else for (auto const& a : array) {
-            if (array[0].get_type() != a->get_type()) {
-                skipIndent = false;
-                break;
+void doc_t::serialize(std::string& out, bool const pretty) const {
+    if (root)
+        writer_t(out, pretty).write(*root);
+}
+
+bool doc_t::make_index(std::string_view const path, bool const ordered) {
+    auto const segs = su::split(path, '/');
+    if (!root || segs.empty())
+        return false;
+    auto const name = [](std::string_view s) { return !s.empty() && s.front() == '@' ? s.substr(1) : s; };
+    std::vector<value_t const*> level{ root.get() }, next;
+    for (size_t i = 0; i + 1 < segs.size(); i++) {
+        hkey_t const key(name(segs[i]));
+        next.clear();
+        for (auto const* v : level) {
+            if (auto const* obj = v->get_if_object()) {
+                if (auto const* p = (*obj)(key))
+                    next.push_back(&p->get_value());
+            } else if (auto const* arr = v->get_if_array()) {
+                for (auto const& e : *arr) {
+                    auto const* o = e->get_if_object();
+                    if (auto const* p = o ? (*o)(key) : nullptr)
+                        next.push_back(&p->get_value());
+                }
             }
         }
+        level.swap(next);
     }
+    bool made = false;
+    for (auto const* v : level) {
+        if (auto const* arr = v->get_if_array()) {
+            arr->make_index(name(segs.back()), ordered ? field_index_t::kind_t::ordered : field_index_t::kind_t::hash);
+            made = true;
+        }
+    }
+    return made;
+}
 
-    //skipIndent = false; // force new line for array element, or calculate string length
-    if (!skipIndent)
-        fprintf(f, "\n");
-
-    for (size_t i = 0; i < array.size(); i++) {
-        if (i) {
-            if (skipIndent)
-                fprintf(f, ",");
-            else
-                fprintf(f, ",\n");
+std::optional<range_t> range_t::parse(std::string_view const pred) {
+    size_t op = pred.find_first_of("<>");
+    if (op == std::string_view::npos || pred.substr(0, op).find('=') != std::string_view::npos) // name=a<b is an equality
+        return std::nullopt;
+    range_t r;
+    r.key = hkey_t(pred.substr(0, op));
+    bool upper = false, lower = false;
+    while (op < pred.size()) { // one bound per op: < <= give hi, > >= give lo
+        bool const less = pred[op] == '<';
+        bool const eq = op + 1 < pred.size() && pred[op + 1] == '=';
+        size_t const end = std::min(pred.find_first_of("<>", op + 1), pred.size());
+        auto const text = pred.substr(op + 1 + eq, end - op - 1 - eq);
+        double d;
+        auto const [ptr, ec] = parse_double(text.data(), text.data() + text.size(), d);
+        if (text.empty() || ec != std::errc() || ptr != text.data() + text.size() || (less ? upper : lower))
+            return std::nullopt;
+        if (less) {
+            r.hi = d;
+            r.hi_open = !eq;
+            upper = true;
+        } else {
+            r.lo = d;
+            r.lo_open = !eq;
+            lower = true;
         }
-        serialize(f, indent + "\t", array[i], skipIndent);
+        op = end;
     }
+    return r;
+}
 
-    if (skipIndent)
-        fprintf(f, "]");
-    else
-        fprintf(f, "\n%s]", indent.c_str());
+jpath_t::plan_t jpath_t::compile(std::string_view const path) {
+    plan_t plan;
+    plan.text = std::make_unique<std::string>(path);
+    for (auto const sc : su::split(std::string_view(*plan.text), '/')) {
+        auto const dog = su::split(sc, '@');
+        if (dog.empty() || dog.size() > 2)
+            break; // the path ends here, what was found so far is the result
+        plan_t::step_t s;
+        if (dog.size() == 1) {
+            s.key = hkey_t(dog.front());
+        } else if (auto const r = range_t::parse(dog.back())) {
+            s.op = plan_t::op_t::range;
+            s.range = *r;
+        } else if (auto const eq = su::split(dog.back(), '='); eq.size() == 2) {
+            s.op = plan_t::op_t::equals;
+            s.key = hkey_t(eq.front());
+            s.recs.emplace_back(eq.front(), eq.back()); // support diff types
+        } else if (auto const [ptr, ec] = std::from_chars(dog.back().data(), dog.back().data() + dog.back().size(), s.index, 10); ec == std::errc()) {
+            s.op = plan_t::op_t::index;
+        } else {
+            s.key = hkey_t(dog.back());
+        }
+        plan.steps.push_back(std::move(s));
+    }
+    return plan;
 }
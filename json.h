@@ -3,10 +3,14 @@
 #include <algorithm>
 #include <cassert>
 #include <charconv>
+#include <cmath>
+#include <cstring>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <numeric>
 #include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -15,6 +19,8 @@
 
 #include "strs.h"
 #include "fnv.h"
+#include "number.h"
+#include "simd.h"
 
 // []{}:,. eE+-\"\t\r\n
 // ' '=x20, '\t'=x09, '\r'=x0A, '\n'=x0D
@@ -28,7 +34,6 @@
 //object='{' [ member *(',' member) ] '}'
 
 // hide core classes => doc_t::[value_t, pair_t, object_t, array_t], api: json::doc_t, json::jpath_t
-// bjson
 // replace type_t::empty with type_t::null
 // replace type_t with std::variant::index()
 // ?mm
@@ -71,10 +76,66 @@ namespace json {
     inline constexpr bool is_dot(char const ch) noexcept { return ch == '.'; }
     inline constexpr bool is_ws(char const ch) noexcept { return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n'; }
 
+    // \uXXXX becomes UTF-8 (surrogate pairs combined, a lone surrogate U+FFFD), the result is never longer than sv
+    // unescape_to: dst needs sv.size() bytes, returns the decoded size or npos on a malformed escape
+    size_t unescape_to(std::string_view const sv, char* const dst) noexcept;
     std::pair<std::string, bool> unescape(std::string_view const sv);
+    std::pair<std::string_view, bool> unescape(std::string_view const sv, std::pmr::memory_resource* mr); // decoded into mr (an arena)
     std::string unescape(std::string_view s, bool escaped);
     std::string escape(std::string_view s);
 
+    // escaped form of s (no quotes) in pieces: put(std::string_view) gets the clean runs in bulk
+    // (found by simd::find_escape) and the escape sequence of each '"', '\\' and control char between them
+    template <typename P> void escape(std::string_view const s, P&& put) {
+        static constexpr char hex[] = "0123456789abcdef";
+        for (size_t pos = 0; pos < s.size(); ) {
+            size_t const e = simd::find_escape(s.data(), pos, s.size());
+            if (e > pos)
+                put(s.substr(pos, e - pos));
+            if (e == s.size())
+                break;
+            switch (char const ch = s[e]) {
+            case '\"': put(std::string_view("\\\"")); break;
+            case '\\': put(std::string_view("\\\\")); break;
+            case '\b': put(std::string_view("\\b")); break;
+            case '\f': put(std::string_view("\\f")); break;
+            case '\n': put(std::string_view("\\n")); break;
+            case '\r': put(std::string_view("\\r")); break;
+            case '\t': put(std::string_view("\\t")); break;
+            default: {
+                char const u[] = { '\\', 'u', '0', '0', hex[(ch >> 4) & 0xF], hex[ch & 0xF] };
+                put(std::string_view(u, sizeof(u)));
+            }
+            }
+            pos = e + 1;
+        }
+    }
+
+    enum class errc_t : uint8_t {
+        none,
+        eof,      // input ended inside a value
+        value,    // value expected
+        number,   // malformed number
+        string,   // malformed string or escape
+        colon,    // ':' expected after a member name
+        bracket,  // ']' or '}' expected
+        trailing, // non-whitespace after the root value
+        io,       // the file can't be opened or mapped (doc_t::load_file), errno tells why
+        utf8,     // invalid UTF-8 sequence (options_t::utf8), offset is its first byte
+    };
+
+    struct parse_error_t {
+        errc_t code{ errc_t::none };
+        size_t offset{ 0 };      // byte offset into the source, reader_t::location() gives line/column
+        char const* what{ "" };  // static text, never allocated
+
+        explicit operator bool() const noexcept { return code != errc_t::none; }
+    };
+
+    // reads past the end yield '\0', which no predicate of the grammar accepts, so callers need no bounds check of their own;
+    // get() itself still compares against the size (no sentinel: the input is a view, ndjson records and lazy containers
+    // are slices of a larger text), the hot loops skip whole blocks instead (skip_ws, skip_digits, simd.h)
+    // a failure keeps the first error and moves to the end: every caller up the recursion just falls through
     class reader_t {
     public:
         reader_t(std::string_view src) : data(src) { reset(); }
@@ -86,23 +147,36 @@ namespace json {
         void set_position(size_t const position) { pos = position; }
         bool done(size_t const ofs = 0) const { return pos + ofs >= data.size(); }
         bool has(std::string_view ref) const { return ref.size() <= rest() && ref == substr(position(), ref.size()); }
-        bool has(char const ch) const { return rest() && ch == get(); }
-        template <typename P> bool has(P p) const { return rest() && p(get()); }
-        char get() const { return data[position()]; }
+        bool has(char const ch) const { return ch == get(); }
+        template <typename P> bool has(P p) const { return p(get()); }
+        char get() const { return pos < data.size() ? data[pos] : '\0'; }
         char const* get_base_ptr(size_t const ofs = 0) const noexcept { return data.data() + ofs; }
         char const* get_pos_ptr(size_t const ofs = 0) const noexcept { return data.data() + pos + ofs; }
-        char read() { check(); get() == '\n' ? (line++, column = 1) : column++; return data[pos++]; }
+        char read() { assert(!done()); return data[pos++]; }
         bool skip(char const ch) { return !has(ch) ? false : (read(), true); }
         template <typename P> bool skip(P p) { return !has(p) ? false : (read(), true); }
         bool skip(std::string_view ref) { return !has(ref) ? false : (skip(ref.size()), true); }
-        void reset() { pos = 0; line = 1; column = 1; }
-        bool skip(size_t const count) { return done() || count >= rest() ? false : (pos += count, true); }
+        void reset() { pos = 0; err = {}; }
+        bool skip(size_t const count) { return count > rest() ? false : (pos += count, true); }
         void skip_while(char const ch) { for (; !done() && ch == get(); read()); } // mm
         void skip_until(char const ch) { for (; !done() && ch != get(); read()); } // mm
         template <typename P> void skip_while(P p) { for (; !done() && p(get()); read()); }
         template <typename P> void skip_until(P p) { for (; !done() && !p(get()); read()); }
         void skip_while(std::string_view s) { for (; !done() && s.find_first_of(get()) != s.npos; read()); }
 
+        // 1-based line/column of ofs, computed on demand (error path only)
+        std::pair<size_t, size_t> location(size_t ofs) const {
+            ofs = std::min(ofs, data.size());
+            size_t const line = 1 + simd::count(data.data(), 0, ofs, '\n');
+            size_t const nl = ofs ? data.rfind('\n', ofs - 1) : data.npos;
+            return { line, nl == data.npos ? ofs + 1 : ofs - nl };
+        }
+
+        // block skips (simd.h)
+        void skip_ws() { pos = simd::skip_ws(data.data(), pos, data.size()); }
+        void skip_digits() { pos = simd::skip_digits(data.data(), pos, data.size()); }
+        void skip_to_quote_or_backslash() { pos = simd::find_quote_or_backslash(data.data(), pos, data.size()); }
+
         void skip_line(size_t const count) {
             for (int i = static_cast<int>(count); i--; ) {
                 for (; !done() && get() != '\n'; read());
@@ -143,35 +217,179 @@ namespace json {
             return r;
         }
 
-    private:
-        void check_base(size_t const ofs = 0) const {
-            assert(ofs <= data.size());
-            if (ofs >= data.size())
-                throw std::exception("check failed");
-        }
-
-        void check(size_t const ofs = 0) const {
-            assert(pos + ofs <= data.size());
-            if (done(ofs))
-                throw std::exception("check failed");
+        bool failed() const noexcept { return bool(err); }
+        parse_error_t const& error() const noexcept { return err; }
+        void fail(errc_t const code, char const* what) {
+            if (!failed())
+                err = { done() ? errc_t::eof : code, pos, what };
+            pos = data.size();
         }
 
     private:
         std::string_view data;
         size_t pos;
-        size_t line;
-        size_t column;
+        parse_error_t err;
         // ??? char read() -> char const* read() { return check() ? data.data() : nullptr; }, iterators
         // ptr will help to check string since the current position symbol
     };
 
     class array_t;
     class object_t;
+    class lazy_t;
+
+    // all document nodes, vector buffers and local strings are carved from the doc_t arena,
+    // node_ptr only runs destructors, the memory itself is released with the arena in one step
+    using arena_t = std::pmr::monotonic_buffer_resource;
+
+    template <typename T> struct arena_delete_t {
+        void operator () (T* p) const noexcept { p->~T(); }
+    };
+
+    template <typename T> using node_ptr = std::unique_ptr<T, arena_delete_t<T>>;
+
+    // the arena object of a doc: on the heap, or carved from the upstream arena it allocates from
+    // (options_t::upstream, ndjson batches), there it is only destroyed
+    struct arena_free_t {
+        bool heap{ true };
+        void operator () (arena_t* const a) const noexcept { if (heap) delete a; else a->~arena_t(); }
+    };
+
+    using arena_ptr = std::unique_ptr<arena_t, arena_free_t>;
+
+    inline arena_ptr make_arena(size_t const size, std::pmr::memory_resource* const upstream = nullptr) {
+        if (!upstream)
+            return arena_ptr(new arena_t(size));
+        void* const p = upstream->allocate(sizeof(arena_t), alignof(arena_t));
+        return arena_ptr(new (p) arena_t(size, upstream), arena_free_t{ false });
+    }
+
+    template <typename T, typename... A> node_ptr<T> make_node(std::pmr::memory_resource* mr, A&&... args) {
+        void* const p = mr->allocate(sizeof(T), alignof(T));
+        return node_ptr<T>(new (p) T(std::forward<A>(args)...));
+    }
+
+    inline std::string_view arena_str(std::pmr::memory_resource* mr, std::string_view const s) {
+        if (s.empty())
+            return {};
+        char* const p = static_cast<char*>(mr->allocate(s.size(), 1));
+        memcpy(p, s.data(), s.size());
+        return std::string_view(p, s.size());
+    }
+
+    // distinct member name of a document: raw text with quotes, fnv1a of the name between them
+    struct name_t {
+        char const* text;
+        uint32_t size;
+        uint32_t hash;
+
+        std::string_view raw() const { return std::string_view(text, size); }
+        std::string_view name() const { return size >= 2 ? std::string_view(text + 1, size - 2) : std::string_view(); }
+    };
+
+    // member name hashed once: at compile time for a literal ("id"_key, static constexpr hkey_t id{ "id" }),
+    // lookups by hkey_t probe with the hash as is and compare the text only on a hash hit
+    struct hkey_t {
+        std::string_view name;
+        uint32_t hash;
+
+        constexpr explicit hkey_t(std::string_view const n) : name{ n }, hash{ fnv1a_32_2(n.data(), n.size()) } {}
+    };
+
+    inline namespace literals {
+        constexpr hkey_t operator"" _key(char const* s, size_t const n) { return hkey_t(std::string_view(s, n)); }
+    }
+
+    // interned member names: pairs point to one shared name_t per distinct name, hashed once
+    // - linear probing over name_t* slots from a quick hash, load <= 1/2, slots and names live in the arena
+    // - not thread safe: every parse thread (parallel workers, lazy builds, clone) has a table of its own,
+    //   so equal names in one tree may be different name_t's - compare hash and text, not addresses
+    class names_t {
+    public:
+        explicit names_t(std::pmr::memory_resource* const _mr) : mr{ _mr }, slots(_mr) {}
+
+        std::pmr::memory_resource* resource() const { return mr; }
+        size_t memory() const { return sizeof(names_t) + slots.capacity() * sizeof(name_t const*) + count * sizeof(name_t); }
+        size_t size() const { return count; }
+
+        // copy: the text of a new name goes to the arena, otherwise it stays a view of raw
+        name_t const* intern(std::string_view const raw, bool const copy) {
+            if (raw.size() > UINT32_MAX)
+                throw std::length_error("member name over 4GB");
+            if (count * 2 >= slots.size())
+                grow();
+            size_t const mask = slots.size() - 1;
+            size_t i = quick(raw.data(), raw.size()) & mask;
+            for (; slots[i]; i = (i + 1) & mask) {
+                if (slots[i]->size == raw.size() && !memcmp(slots[i]->text, raw.data(), raw.size()))
+                    return slots[i];
+            }
+            auto const text = copy ? arena_str(mr, raw) : raw;
+            auto const name = text.size() >= 2 ? text.substr(1, text.size() - 2) : std::string_view();
+            auto* const n = new (mr->allocate(sizeof(name_t), alignof(name_t)))
+                name_t{ text.data(), static_cast<uint32_t>(text.size()), fnv1a_32_2(name.data(), name.size()) };
+            slots[i] = n;
+            count++;
+            return n;
+        }
+
+    private:
+        // probe hash only, reads the length and the first/last 8 bytes
+        static uint32_t quick(char const* const s, size_t const n) {
+            uint64_t a = 0, b = 0;
+            if (n >= 8) {
+                memcpy(&a, s, 8);
+                memcpy(&b, s + n - 8, 8);
+            } else {
+                memcpy(&a, s, n);
+            }
+            uint64_t const h = (a ^ (b >> 7) ^ (b << 29) ^ n) * 0x9e3779b97f4a7c15ull;
+            return static_cast<uint32_t>(h >> 32);
+        }
+
+        void grow() {
+            std::pmr::vector<name_t const*> old(slots.get_allocator());
+            old.swap(slots);
+            slots.assign(old.empty() ? 8 : old.size() * 2, nullptr);
+            size_t const mask = slots.size() - 1;
+            for (auto const* n : old) {
+                if (!n)
+                    continue;
+                size_t i = quick(n->text, n->size) & mask;
+                while (slots[i])
+                    i = (i + 1) & mask;
+                slots[i] = n;
+            }
+        }
+
+    private:
+        std::pmr::memory_resource* mr;
+        std::pmr::vector<name_t const*> slots; // power of 2, nullptr - empty
+        size_t count{ 0 };
+    };
 
     using record_t = std::pair<std::string_view, std::variant<bool, int64_t, double, std::string_view>>;
+    using number_t = std::variant<int64_t, uint64_t, double>; // exact number tag decoded on parse (options_t::numbers)
+
+    // numeric range of a member, jpath @level>=5, @price<10, between: @year>=1990<=1999 (bounds of both directions)
+    // values compare as double, like get<double>(); the member name is hashed once, by parse()
+    struct range_t {
+        hkey_t key{ std::string_view() };
+        double lo{ -HUGE_VAL };
+        double hi{ HUGE_VAL };
+        bool lo_open{ false }; // lo itself excluded
+        bool hi_open{ false };
+
+        bool has(double const v) const { return (lo_open ? v > lo : v >= lo) && (hi_open ? v < hi : v <= hi); }
+
+        // "level>=5" (name op number, op: < <= > >=), "year>=1990<=1999" (a second op the other way), nullopt for anything else;
+        // no '=' form, @name=... is always an equality of a string (@id=1..2 matches "1..2")
+        static std::optional<range_t> parse(std::string_view const pred);
+    };
 
     class value_t {
-        using data_t = std::variant<bool, int64_t, double, std::string_view, std::unique_ptr<array_t>, std::unique_ptr<object_t>>;
+        // monostate - nothing decoded yet, the first decoded representation stays cached
+        // lazy_t* - container not built yet (options_t::lazy), source is its raw extent
+        using data_t = std::variant<std::monostate, bool, int64_t, uint64_t, double, std::string_view, node_ptr<array_t>, node_ptr<object_t>, lazy_t*>;
 
     public:
         enum class type_t { empty, null, boolean, number, string, object, array };
@@ -182,25 +400,17 @@ namespace json {
     public:
         value_t() = delete;
         value_t(value_t&& v) = default;
-        value_t(value_t const& v) : store(v.get_raw_str()) {
-            type = v.type;
-            escaped = v.escaped;
-
-            switch (type) {
-            case type_t::array:
-                value = std::make_unique<array_t>(*std::get<std::unique_ptr<array_t>>(v.value));
-                break;
-            case type_t::object:
-                value = std::make_unique<object_t>(*std::get<std::unique_ptr<object_t>>(v.value));
-                break;
-            }
-        }
+        value_t(value_t const& v) = delete;
+        value_t(value_t const& v, names_t& names); // deep copy into the arena of names, strings become local
 
         explicit value_t(type_t const _type, data_t&& _data) : type{ _type }, value{ std::move(_data) } {}
-        explicit value_t(type_t const _type, std::string_view const _source, bool const _escaped = false, bool const local = false)
-            : type{ _type }, escaped{ _escaped } { if (local) store = _source; else source = _source; }
-        explicit value_t(std::unique_ptr<array_t> array) : type{ type_t::array }, value{ std::move(array) } {}
-        explicit value_t(std::unique_ptr<object_t> object) : type{ type_t::object }, value{ std::move(object) } {}
+        explicit value_t(type_t const _type, std::string_view const _source, bool const _escaped = false)
+            : source{ _source }, type{ _type }, escaped{ _escaped } {}
+        explicit value_t(std::string_view const _source, number_t const& num)
+            : source{ _source }, type{ type_t::number } { std::visit([this](auto const n) { value = n; }, num); }
+        explicit value_t(node_ptr<array_t> array) : type{ type_t::array }, value{ std::move(array) } {}
+        explicit value_t(node_ptr<object_t> object) : type{ type_t::object }, value{ std::move(object) } {}
+        explicit value_t(type_t const _type, std::string_view const _source, lazy_t* const lazy) : value{ lazy }, source{ _source }, type{ _type } {}
 
         value_t& operator = (value_t&&) = default;
 
@@ -226,15 +436,18 @@ namespace json {
         bool is_array() const { return type == type_t::array; }
 
         type_t get_type() const { return type; }
-        std::string_view get_raw_str() const { return store.size() ? store : source; }
-        object_t const& get_object() const { return *std::get<std::unique_ptr<object_t>>(value); }
-        array_t const& get_array() const { return *std::get<std::unique_ptr<array_t>>(value); }
-        object_t& get_object() { return *std::get<std::unique_ptr<object_t>>(value); }
-        array_t& get_array() { return *std::get<std::unique_ptr<array_t>>(value); }
-        object_t const* get_if_object() const { auto* ptr = std::get_if<std::unique_ptr<object_t>>(&value); return ptr ? ptr->get() : nullptr; }
-        array_t const* get_if_array() const { auto* ptr = std::get_if<std::unique_ptr<array_t>>(&value); return ptr ? ptr->get() : nullptr; }
-        object_t* get_if_object() { auto* ptr = std::get_if<std::unique_ptr<object_t>>(&value); return ptr ? ptr->get() : nullptr; }
-        array_t* get_if_array() { auto* ptr = std::get_if<std::unique_ptr<array_t>>(&value); return ptr ? ptr->get() : nullptr; }
+        std::string_view get_raw_str() const { return source; }
+        object_t const& get_object() const { expand(); return *std::get<node_ptr<object_t>>(value); }
+        array_t const& get_array() const { expand(); return *std::get<node_ptr<array_t>>(value); }
+        object_t& get_object() { expand(); return *std::get<node_ptr<object_t>>(value); }
+        array_t& get_array() { expand(); return *std::get<node_ptr<array_t>>(value); }
+        object_t const* get_if_object() const { expand(); auto* ptr = std::get_if<node_ptr<object_t>>(&value); return ptr ? ptr->get() : nullptr; }
+        array_t const* get_if_array() const { expand(); auto* ptr = std::get_if<node_ptr<array_t>>(&value); return ptr ? ptr->get() : nullptr; }
+        object_t* get_if_object() { expand(); auto* ptr = std::get_if<node_ptr<object_t>>(&value); return ptr ? ptr->get() : nullptr; }
+        array_t* get_if_array() { expand(); auto* ptr = std::get_if<node_ptr<array_t>>(&value); return ptr ? ptr->get() : nullptr; }
+        bool is_lazy() const { return std::holds_alternative<lazy_t*>(value); }
+        // builds a lazy container now (deep: and every container below it), the first error is returned, not thrown
+        parse_error_t build(bool const deep = true) const;
 
         template <typename T> T const* get_if() const { return std::get_if<T>(&value); }
         template <> int const* get_if<int>() const { auto* v = std::get_if<int64_t>(&value); return v ? reinterpret_cast<int const*>(v) :nullptr ; }
@@ -243,15 +456,20 @@ namespace json {
         value_t* operator () (size_t const i) { return const_cast<value_t*>(_find(i)); }
         value_t const* operator () (int const i) const { return _find(i); }
         value_t* operator () (int const i) { return const_cast<value_t*>(_find(i)); }
-        value_t const* operator () (std::string_view const name) const { return _find(name); }
-        value_t* operator () (std::string_view const name) { return const_cast<value_t*>(_find(name)); }
+        value_t const* operator () (std::string_view const name) const { return _find(hkey_t(name)); }
+        value_t* operator () (std::string_view const name) { return const_cast<value_t*>(_find(hkey_t(name))); }
+        value_t const* operator () (hkey_t const& key) const { return _find(key); }
+        value_t* operator () (hkey_t const& key) { return const_cast<value_t*>(_find(key)); }
         value_t const* operator () (std::vector<record_t> const& recs) const { return _find(recs); }
         value_t* operator () (std::vector<record_t> const& recs) { return const_cast<value_t*>(_find(recs)); }
+        value_t const* operator () (range_t const& r) const { return _find(r); }
+        value_t* operator () (range_t const& r) { return const_cast<value_t*>(_find(r)); }
 
         template <typename T> T get(T const def = T()) const { assert(0 && "value_t::get unknown type"); return T(); }
         template <> std::string_view get<std::string_view>(std::string_view const def) const { return get_value<std::string_view>(def); }
         template <> int get<int>(int const def) const { return static_cast<int>(get_value<int64_t>(def)); }
         template <> int64_t get<int64_t>(int64_t const def) const { return get_value<int64_t>(def); }
+        template <> uint64_t get<uint64_t>(uint64_t const def) const { return get_value<uint64_t>(def); }
         template <> double get<double>(double const def) const { return get_value<double>(def); }
         template <> bool get<bool>(bool const def) const { return get_value<bool>(def); }
 
@@ -267,6 +485,7 @@ namespace json {
         }
 
         //set<int>(10) => 10, set_str_as<int>(10) => "10"
+        // set<T>: number or bool, a number keeps no source text - writer_t formats it (shortest round trip)
         bool set(std::string const& v);
         bool set_add(std::string const& v);
         template <typename T> bool set(T const v);
@@ -277,24 +496,39 @@ namespace json {
         template <typename T> bool set_add_str_as(T const v);
 
     private:
+        friend class lazy_t;
+
+        void expand() const; // lazy container: built on first touch
+
         template <typename T> T get_value(T const def = T()) const {
             if (auto const* cached = std::get_if<T>(&value))
                 return *cached;
 
-            if constexpr (std::is_same_v<T, std::string_view>)
-                value = str_as<std::string_view>();
-            else if constexpr (std::is_same_v<T, bool>)
-                value = get_number<bool>(get_raw_str());
-            //else if constexpr (std::is_same_v<T, int>)
-            //    value = get_number<int>(get_raw_str());
-            else if constexpr (std::is_same_v<T, int64_t>)
-                value = get_number<int64_t>(get_raw_str());
-            else if constexpr (std::is_same_v<T, double>)
-                value = get_number<double>(get_raw_str());
-            else
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                auto const sv = str_as<std::string_view>();
+                if (std::holds_alternative<std::monostate>(value))
+                    value = sv;
+                return sv;
+            } else if constexpr (std::is_same_v<T, bool>) {
+                return get_number<bool>(get_raw_str(), def);
+            } else if constexpr (std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> || std::is_same_v<T, double>) {
+                if constexpr (std::is_same_v<T, double>) { // exact for decoded integers, same result as from_chars
+                    if (auto const* i = std::get_if<int64_t>(&value))
+                        return static_cast<double>(*i);
+                    if (auto const* u = std::get_if<uint64_t>(&value))
+                        return static_cast<double>(*u);
+                }
+                if (source.empty()) // set<T>(): nothing to parse, the stored number converts
+                    return std::visit([def](auto const& n) -> T {
+                        if constexpr (std::is_arithmetic_v<std::decay_t<decltype(n)>>)
+                            return static_cast<T>(n);
+                        else
+                            return def;
+                    }, value);
+                return get_number<T>(get_raw_str(), def);
+            } else {
                 static_assert(0 && "type not supported");
-
-            return std::get<T>(value);
+            }
         }
 
         template <typename T> T get_as(T const def = T()) const {
@@ -309,8 +543,9 @@ namespace json {
             auto const [ptr, ec] = std::from_chars(src.data(), src.data()+src.size(), val, 10);
             if (ec != std::errc()) // checked on parse stage
                 return def;
-            value = val;
-            return std::get<T>(value);
+            if (ptr == src.data() + src.size() && std::holds_alternative<std::monostate>(value)) // "1.5", "1e3": a prefix only, not the number
+                value = val;
+            return val;
         }
 
         template <typename T, std::enable_if_t<std::is_floating_point_v<T>, bool> = true>
@@ -318,11 +553,16 @@ namespace json {
             if (src.empty())
                 return def;
             T val;
-            auto const [ptr, ec] = std::from_chars(src.data(), src.data() + src.size(), val);
-            if (ec != std::errc()) // checked on parse stage
+            std::from_chars_result res;
+            if constexpr (std::is_same_v<T, double>)
+                res = parse_double(src.data(), src.data() + src.size(), val);
+            else
+                res = std::from_chars(src.data(), src.data() + src.size(), val);
+            if (res.ec != std::errc()) // checked on parse stage
                 return def;
-            value = val;
-            return std::get<T>(value);
+            if (res.ptr == src.data() + src.size() && std::holds_alternative<std::monostate>(value))
+                value = val;
+            return val;
         }
 
         template <typename T, std::enable_if_t<std::is_same_v<T, bool>, bool> = true>
@@ -332,8 +572,9 @@ namespace json {
 
         value_t const* _find(size_t const i) const;
         value_t const* _find(int const i) const;
-        value_t const* _find(std::string_view const name) const;
+        value_t const* _find(hkey_t const& key) const;
         value_t const* _find(std::vector<record_t> const& recs) const;
+        value_t const* _find(range_t const& r) const;
 
         static std::string escape(std::string_view const src);
         static std::string unescape(std::string_view const src);
@@ -342,7 +583,6 @@ namespace json {
     private:
         mutable data_t value;
         std::string_view source;
-        std::string store;
         type_t type{ type_t::empty };
         bool escaped{ false };
     };
@@ -350,19 +590,13 @@ namespace json {
     class pair_t {
     public:
         pair_t() = default;
-        pair_t(std::string_view n, std::unique_ptr<value_t>&& v, bool const local = false) : value{ std::move(v) } {
-            if (local) raw_name_store = n; else raw_name = n;
-        }
+        pair_t(name_t const* const n, node_ptr<value_t>&& v) : key{ n }, value{ std::move(v) } {}
         pair_t(pair_t&&) = default;
-        pair_t(pair_t const& p) {
-            raw_name_store = p.get_raw_name();
-            value = std::make_unique<value_t>(*p.value);
-        }
+        pair_t(pair_t const& p, names_t& names)
+            : key{ names.intern(p.get_raw_name(), true) }, value{ make_node<value_t>(names.resource(), *p.value, names) } {}
 
         size_t memory() const {
             size_t mem = sizeof(pair_t);
-            if (raw_name_store.capacity())
-                mem += raw_name_store.capacity();
             if (value)
                 mem += value->memory();
             return mem;
@@ -370,50 +604,106 @@ namespace json {
 
         pair_t& operator = (pair_t&&) = default;
 
-        std::string_view get_raw_name() const { return raw_name.size() ? raw_name : raw_name_store; }
-        std::string_view get_name() const { auto r = get_raw_name(); return r.size() >= 2 ? r.substr(1, r.size() - 2) : std::string_view(); }
+        std::string_view get_raw_name() const { return key->raw(); }
+        std::string_view get_name() const { return key->name(); }
+        uint32_t get_hash() const { return key->hash; } // fnv1a_32_2 of get_name()
         value_t const& get_value() const { return *value; }
         value_t& get_value() { return *value; }
 
         value_t* operator () (std::string_view const name, std::vector<record_t> const& recs, bool const _explicit = true);
 
     private:
-        std::string_view raw_name;
-        std::string raw_name_store;
-        std::unique_ptr<value_t> value;
+        name_t const* key{ nullptr }; // interned, see names_t
+        node_ptr<value_t> value;
     };
 
+    // key index of a large object, kept up to date by object_t::add
+    // - open addressing with linear probing over (name hash, pair position + 1) slots, load <= 3/4
+    // - the hashes come with the interned names (pair_t::get_hash), nothing is rehashed
+    // - a hash hit is confirmed by comparing the name, so colliding hashes only cost a compare
+    // - a repeated name isn't indexed, lookups find its first pair like the linear scan does
     class indices_t {
     public:
-        indices_t() = default;
+        static constexpr size_t min_pairs = 16; // smaller objects are scanned
+
+        explicit indices_t(std::pmr::memory_resource* mr) : slots(mr) {}
+
+        size_t memory() const { return sizeof(indices_t) + slots.capacity() * sizeof(slot_t); }
+        size_t size() const { return count; }
+
+        // indexes pairs[size(), pairs.size())
+        void add(std::pmr::vector<pair_t> const& pairs) {
+            if (pairs.size() > UINT32_MAX - 1)
+                throw std::length_error("object over 4G members");
+            if (pairs.size() * 4 > slots.size() * 3)
+                grow(pairs.size());
+            for (; count < pairs.size(); count++)
+                insert(pairs, pairs[count].get_hash(), static_cast<uint32_t>(count + 1));
+        }
+
+        // hash: fnv1a_32_2 of name
+        pair_t const* find(std::pmr::vector<pair_t> const& pairs, std::string_view const name, uint32_t const hash) const {
+            size_t const mask = slots.size() - 1;
+            for (size_t i = hash & mask; slots[i].pos; i = (i + 1) & mask) {
+                if (slots[i].hash == hash && pairs[slots[i].pos - 1].get_name() == name)
+                    return &pairs[slots[i].pos - 1];
+            }
+            return nullptr;
+        }
 
-        size_t memory() const { return 0; }
-        void add(std::string_view const id, uint16_t const index) {
-            remap[fnva16hash<std::string_view>()(id)] = index;
+    private:
+        struct slot_t {
+            uint32_t hash;
+            uint32_t pos; // 0 - empty
+        };
+
+        void grow(size_t const n) {
+            size_t size = 16;
+            while (n * 2 > size) // load 1/2 right after a grow
+                size *= 2;
+            std::pmr::vector<slot_t> old(slots.get_allocator());
+            old.swap(slots);
+            slots.assign(size, slot_t{});
+            size_t const mask = slots.size() - 1;
+            for (auto const& s : old) { // names are unique in the table already
+                if (!s.pos)
+                    continue;
+                size_t i = s.hash & mask;
+                while (slots[i].pos)
+                    i = (i + 1) & mask;
+                slots[i] = s;
+            }
         }
 
-        std::pair<uint16_t, bool> get(uint16_t const index) const {
-            auto it = remap.find(index);
-            return it != remap.end() ? std::make_pair(it->second, true) : std::make_pair(0ui16, false);
+        void insert(std::pmr::vector<pair_t> const& pairs, uint32_t const hash, uint32_t const pos) {
+            size_t const mask = slots.size() - 1;
+            size_t i = hash & mask;
+            for (; slots[i].pos; i = (i + 1) & mask) {
+                if (slots[i].hash == hash && pairs[slots[i].pos - 1].get_name() == pairs[pos - 1].get_name())
+                    return;
+            }
+            slots[i] = slot_t{ hash, pos };
         }
 
     private:
-        std::unordered_map<uint16_t, uint16_t> remap;
-        //todo: vector:table + vector:remap + reindex:sort - less memory
+        std::pmr::vector<slot_t> slots; // power of 2
+        size_t count{ 0 };              // pairs indexed
     };
 
     class object_t {
     public:
-        using const_iterator = std::vector<pair_t>::const_iterator;
-        using iterator = std::vector<pair_t>::iterator;
+        using const_iterator = std::pmr::vector<pair_t>::const_iterator;
+        using iterator = std::pmr::vector<pair_t>::iterator;
 
     public:
-        object_t() = default;
+        explicit object_t(std::pmr::memory_resource* mr) : pairs(mr) {}
         object_t(object_t&&) = default;
-        object_t(object_t const& a) {
+        object_t(object_t const& a, names_t& names) : pairs(names.resource()) {
             pairs.reserve(a.pairs.size());
             for (auto const& p : a.pairs)
-                pairs.push_back(pair_t(p));
+                pairs.emplace_back(p, names);
+            if (pairs.size() >= indices_t::min_pairs)
+                index();
         }
 
         size_t memory() const {
@@ -426,17 +716,18 @@ namespace json {
             return mem;
         }
 
+        // the key index is built by add() once the object is large enough, reindex() starts it over
         void reindex() const {
             indices.reset();
-            indices = std::make_unique<indices_t>();
-            assert(indices);
-            if (pairs.size() < 100)
-                return;
-            for (size_t i=0; i<pairs.size(); i++)
-                indices->add(pairs[i].get_name(), static_cast<uint16_t>(i));
+            if (pairs.size() >= indices_t::min_pairs)
+                index();
         }
 
-        void add(pair_t&& p) { pairs.push_back(std::move(p)); }
+        void add(pair_t&& p) {
+            pairs.push_back(std::move(p));
+            if (indices || pairs.size() >= indices_t::min_pairs)
+                index();
+        }
 
         size_t size() const { return pairs.size(); }
         const_iterator begin() const { return pairs.begin(); }
@@ -449,41 +740,48 @@ namespace json {
 
         pair_t* operator () (size_t const i) { return const_cast<pair_t*>(_find(i)); }
         pair_t* operator () (int i) { return const_cast<pair_t*>(_find(i)); }
-        pair_t* operator () (std::string_view const name) { return const_cast<pair_t*>(_find(name)); }
+        pair_t* operator () (std::string_view const name) { return const_cast<pair_t*>(_find(hkey_t(name))); }
+        pair_t* operator () (hkey_t const& key) { return const_cast<pair_t*>(_find(key)); }
 
         pair_t const* operator () (size_t const i) const { return _find(i); }
         pair_t const* operator () (int i) const { return _find(i); }
-        pair_t const* operator () (std::string_view const name) const { return _find(name); }
+        pair_t const* operator () (std::string_view const name) const { return _find(hkey_t(name)); }
+        pair_t const* operator () (hkey_t const& key) const { return _find(key); }
 
         bool has(std::vector<record_t> const& recs, bool const _explicit = true) const {
             for (auto const& rec : recs) {
-                auto it = std::find_if(pairs.begin(), pairs.end(), [&rec, expl=_explicit](pair_t const& p) {
-                    if (p.get_name() != rec.first)
-                        return false;
-                    if (auto const* b = std::get_if<bool>(&rec.second)) {
-                        if (!p.get_value().is_bool()) return false;
-                        auto const m = p.get_value().get<bool>();
-                        return m == *b;
-                    } else if (auto* i = std::get_if<int64_t>(&rec.second)) {
-                        if (!p.get_value().is_number()) return false;
-                        auto const m = p.get_value().get<int64_t>();
-                        return m == *i;
-                    } else if (auto d = std::get_if<double>(&rec.second)) {
-                        if (!p.get_value().is_number()) return false;
-                        auto const m = p.get_value().get<double>();
-                        return m == *d;
-                    } else if (auto* s = std::get_if<std::string_view>(&rec.second)) {
-                        if (!p.get_value().is_string()) return false;
-                        auto const m = p.get_value().get<std::string_view>();
-                        return m == *s;
-                    }
-                    return true; // only pair name case
-                });
-                if (it == pairs.end())
+                if (!has(rec, fnv1a_32_2(rec.first.data(), rec.first.size())))
                     return false;
             }
             return true;
         }
+
+        // hash: fnv1a_32_2 of rec.first, for callers that test many objects against the same record
+        bool has(record_t const& rec, uint32_t const hash) const {
+            auto it = std::find_if(pairs.begin(), pairs.end(), [&rec, hash](pair_t const& p) {
+                if (p.get_hash() != hash || p.get_name() != rec.first)
+                    return false;
+                if (auto const* b = std::get_if<bool>(&rec.second)) {
+                    if (!p.get_value().is_bool()) return false;
+                    auto const m = p.get_value().get<bool>();
+                    return m == *b;
+                } else if (auto* i = std::get_if<int64_t>(&rec.second)) {
+                    if (!p.get_value().is_number()) return false;
+                    auto const m = p.get_value().get<int64_t>();
+                    return m == *i;
+                } else if (auto d = std::get_if<double>(&rec.second)) {
+                    if (!p.get_value().is_number()) return false;
+                    auto const m = p.get_value().get<double>();
+                    return m == *d;
+                } else if (auto* s = std::get_if<std::string_view>(&rec.second)) {
+                    if (!p.get_value().is_string()) return false;
+                    auto const m = p.get_value().get<std::string_view>();
+                    return m == *s;
+                }
+                return true; // only pair name case
+            });
+            return it != pairs.end();
+        }
     private:
         pair_t const* _find(size_t const i) const { return i <= pairs.size() ? &pairs[i] : nullptr; }
 
@@ -492,52 +790,226 @@ namespace json {
             return i >= 0 && static_cast<size_t>(i) <= pairs.size() ? &pairs[i] : nullptr;
         }
 
-        pair_t const* _find(std::string_view const name) const {
-            auto it = std::find_if(pairs.begin(), pairs.end(), [name](pair_t const& p) { return p.get_name() == name; });
+        // names are compared by their hashes first, the text only on a hash hit
+        pair_t const* _find(hkey_t const& key) const {
+            if (indices && indices->size() == pairs.size())
+                return indices->find(pairs, key.name, key.hash);
+            auto it = std::find_if(pairs.begin(), pairs.end(), [&key](pair_t const& p) { return p.get_hash() == key.hash && p.get_name() == key.name; });
             return it != pairs.end() ? &*it : nullptr;
         }
 
+        void index() const {
+            if (!indices)
+                indices = make_node<indices_t>(pairs.get_allocator().resource(), pairs.get_allocator().resource());
+            indices->add(pairs);
+        }
+
+    private:
+        std::pmr::vector<pair_t> pairs;
+        mutable node_ptr<indices_t> indices;
+    };
+
+    // secondary index of an array of objects on one member (doc_t::make_index)
+    // - hash: string value -> elements, open addressing over (value hash, first/last element + 1) slots,
+    //   load <= 1/2, elements with equal values are chained through next[] in array order, so the first
+    //   match of a path comes first; string members only, what object_t::has compares a string record to
+    // - ordered: column of (get<double>(), element + 1) sorted by value then position, a range_t is two
+    //   binary searches; number members only
+    // - elements that aren't objects or have no such member are left out
+    // - array_t::add extends it (ordered: a sorted insert), a change inside the elements needs array_t::reindex
+    class field_index_t {
+    public:
+        enum class kind_t : uint8_t { hash, ordered };
+
+        struct entry_t {
+            double value;
+            uint32_t pos; // element + 1
+        };
+
+        field_index_t(std::string_view const field, kind_t const _kind, std::pmr::memory_resource* mr)
+            : key{ arena_str(mr, field) }, kind{ _kind }, slots(mr), next(mr), column(mr) {}
+
+        hkey_t const& field() const { return key; }
+        kind_t get_kind() const { return kind; }
+        size_t memory() const {
+            return sizeof(field_index_t) + slots.capacity() * sizeof(slot_t) + next.capacity() * sizeof(uint32_t) + column.capacity() * sizeof(entry_t);
+        }
+        size_t size() const { return count; }
+
+        // indexes values[size(), values.size())
+        void add(std::pmr::vector<node_ptr<value_t>> const& values) {
+            if (values.size() > UINT32_MAX - 1)
+                throw std::length_error("array over 4G elements");
+            if (kind == kind_t::ordered)
+                add_ordered(values);
+            else
+                add_hash(values);
+        }
+
+        // hash: elements with the member equal to sv: pos = find(), then pos = following(pos) while pos, values[pos - 1]
+        uint32_t find(std::pmr::vector<node_ptr<value_t>> const& values, std::string_view const sv) const {
+            if (slots.empty())
+                return 0;
+            uint32_t const hash = fnv1a_32_2(sv.data(), sv.size());
+            size_t const mask = slots.size() - 1;
+            for (size_t i = hash & mask; slots[i].first; i = (i + 1) & mask) {
+                if (slots[i].hash == hash && member(*values[slots[i].first - 1])->get<std::string_view>() == sv)
+                    return slots[i].first;
+            }
+            return 0;
+        }
+
+        uint32_t following(uint32_t const pos) const { return next[pos - 1]; }
+
+        // ordered: the entries within r, in value order
+        std::pair<entry_t const*, entry_t const*> range(range_t const& r) const {
+            auto const below = [](entry_t const& e, double const v) { return e.value < v; };
+            auto const above = [](double const v, entry_t const& e) { return v < e.value; };
+            auto const b = r.lo_open ? std::upper_bound(column.begin(), column.end(), r.lo, above) : std::lower_bound(column.begin(), column.end(), r.lo, below);
+            auto const e = r.hi_open ? std::lower_bound(b, column.end(), r.hi, below) : std::upper_bound(b, column.end(), r.hi, above);
+            return { column.data() + (b - column.begin()), column.data() + (e - column.begin()) };
+        }
+
+        node_ptr<field_index_t> other; // the next index of the same array
+
+    private:
+        struct slot_t {
+            uint32_t hash;
+            uint32_t first; // 0 - empty
+            uint32_t last;
+        };
+
+        // the indexed member of an element if it has the indexed type
+        value_t const* member(value_t const& v) const {
+            if (auto const* obj = v.get_if_object()) {
+                if (auto const* p = (*obj)(key)) {
+                    auto const& m = p->get_value();
+                    if (kind == kind_t::ordered ? m.is_number() : m.is_string())
+                        return &m;
+                }
+            }
+            return nullptr;
+        }
+
+        void add_hash(std::pmr::vector<node_ptr<value_t>> const& values) {
+            next.reserve(values.size());
+            while (count < values.size()) {
+                uint32_t const pos = static_cast<uint32_t>(++count);
+                next.push_back(0);
+                auto const* v = member(*values[pos - 1]);
+                if (!v)
+                    continue;
+                auto const sv = v->get<std::string_view>();
+                uint32_t const hash = fnv1a_32_2(sv.data(), sv.size());
+                if (distinct * 2 >= slots.size())
+                    grow();
+                size_t const mask = slots.size() - 1;
+                size_t i = hash & mask;
+                for (; slots[i].first; i = (i + 1) & mask) {
+                    if (slots[i].hash == hash && member(*values[slots[i].first - 1])->get<std::string_view>() == sv)
+                        break;
+                }
+                if (slots[i].first) {
+                    next[slots[i].last - 1] = pos;
+                    slots[i].last = pos;
+                } else {
+                    slots[i] = slot_t{ hash, pos, pos };
+                    distinct++;
+                }
+            }
+        }
+
+        void add_ordered(std::pmr::vector<node_ptr<value_t>> const& values) {
+            bool const build = count == 0; // sorted once at the end, later elements are inserted in place
+            for (; count < values.size(); count++) {
+                auto const* v = member(*values[count]);
+                if (!v)
+                    continue;
+                entry_t const e{ v->get<double>(), static_cast<uint32_t>(count + 1) };
+                if (build)
+                    column.push_back(e);
+                else // the largest position so far: last among equal values
+                    column.insert(std::upper_bound(column.begin(), column.end(), e.value, [](double const x, entry_t const& y) { return x < y.value; }), e);
+            }
+            if (build)
+                std::sort(column.begin(), column.end(), [](entry_t const& x, entry_t const& y) { return x.value < y.value || (x.value == y.value && x.pos < y.pos); });
+        }
+
+        void grow() {
+            std::pmr::vector<slot_t> old(slots.get_allocator());
+            old.swap(slots);
+            slots.assign(old.empty() ? 16 : old.size() * 2, slot_t{});
+            size_t const mask = slots.size() - 1;
+            for (auto const& s : old) {
+                if (!s.first)
+                    continue;
+                size_t i = s.hash & mask;
+                while (slots[i].first)
+                    i = (i + 1) & mask;
+                slots[i] = s;
+            }
+        }
+
     private:
-        std::vector<pair_t> pairs;
-        mutable std::unique_ptr<indices_t> indices;
+        hkey_t key;
+        kind_t kind;
+        size_t count{ 0 };               // elements indexed
+        std::pmr::vector<slot_t> slots;  // hash: power of 2
+        std::pmr::vector<uint32_t> next; // hash, per element: the next one with the same value + 1, 0 - last
+        size_t distinct{ 0 };
+        std::pmr::vector<entry_t> column; // ordered
     };
 
     class array_t {
     public:
-        using const_iterator = std::vector<std::unique_ptr<value_t>>::const_iterator;
-        using iterator = std::vector<std::unique_ptr<value_t>>::iterator;
+        using const_iterator = std::pmr::vector<node_ptr<value_t>>::const_iterator;
+        using iterator = std::pmr::vector<node_ptr<value_t>>::iterator;
 
     public:
-        array_t() = default;
+        explicit array_t(std::pmr::memory_resource* mr) : values(mr) {}
         array_t(array_t&&) = default;
-        array_t(array_t const& a) {
+        array_t(array_t const& a, names_t& names) : values(names.resource()) {
             values.reserve(a.values.size());
             for (auto const& v : a.values)
-                values.push_back(std::make_unique<value_t>(*v));
+                values.push_back(make_node<value_t>(names.resource(), *v, names));
+            for (auto const* ix = a.indices.get(); ix; ix = ix->other.get())
+                make_index(ix->field().name, ix->get_kind());
         }
 
         size_t memory() const {
             size_t mem = sizeof(array_t);
-            //mem = std::accumulate(values.begin(), values.end(), mem, [](size_t mem, std::unique_ptr<value_t> const& v) {
+            //mem = std::accumulate(values.begin(), values.end(), mem, [](size_t mem, node_ptr<value_t> const& v) {
             //    return v ? mem + v->memory() : mem;
             //});
             for (auto const& v : values) // thumb up for std::accumulate short&clean implementation
                 if (v) mem += v->memory();
-            if (indices)
-                mem += indices->memory();
+            for (auto const* ix = indices.get(); ix; ix = ix->other.get())
+                mem += ix->memory();
             return mem;
         }
 
+        // field indexes (doc_t::make_index) are kept by add(), reindex() rebuilds them after the elements changed
         void reindex() const {
-            indices.reset();
-            indices = std::make_unique<indices_t>();
-            assert(indices);
-            //for (auto const& v : values) { v->is_string(); }
-            //for (size_t i=0; i<pairs.size(); i++)
-            //    indices->add(pairs[i].get_name(), static_cast<uint16_t>(i));
+            auto old = std::move(indices);
+            for (auto const* ix = old.get(); ix; ix = ix->other.get())
+                make_index(ix->field().name, ix->get_kind());
         }
 
-        void add(std::unique_ptr<value_t>&& v) { values.push_back(std::move(v)); }
+        // index on the member field of the object elements (hash: strings, ordered: numbers), once per field and kind
+        void make_index(std::string_view const field, field_index_t::kind_t const kind = field_index_t::kind_t::hash) const {
+            if (index(field, kind))
+                return;
+            auto ix = make_node<field_index_t>(values.get_allocator().resource(), field, kind, values.get_allocator().resource());
+            ix->add(values);
+            ix->other = std::move(indices);
+            indices = std::move(ix);
+        }
+
+        void add(node_ptr<value_t>&& v) {
+            values.push_back(std::move(v));
+            for (auto* ix = indices.get(); ix; ix = ix->other.get())
+                ix->add(values);
+        }
 
         size_t size() const { return values.size(); }
         const_iterator begin() const { return values.begin(); }
@@ -551,10 +1023,52 @@ namespace json {
         value_t* operator () (size_t const i) { return const_cast<value_t*>(_find(i)); }
         value_t* operator () (int i) { return const_cast<value_t*>(_find(i)); }
         value_t* operator () (std::vector<record_t> const& recs, bool const _explicit = true) { return const_cast<value_t*>(_find(recs, _explicit)); }
+        value_t* operator () (range_t const& r) { return const_cast<value_t*>(_find(r)); }
 
         value_t const* operator () (size_t const i) const { return _find(i); }
         value_t const* operator () (int i) const { return _find(i); }
         value_t const* operator () (std::vector<record_t> const& recs, bool const _explicit = true) const { return _find(recs, _explicit); }
+        value_t const* operator () (range_t const& r) const { return _find(r); }
+
+        // one record with the hash of its name known up front (compiled jpath), nothing is allocated
+        value_t const* find(record_t const& rec, uint32_t const hash) const {
+            value_t const* res = nullptr;
+            each(&rec, &hash, 1, [&res](value_t const& v) { res = &v; return false; });
+            return res;
+        }
+
+        // every element matching, in array order; out is only appended to, a reused out allocates nothing
+        void select(std::vector<record_t> const& recs, std::vector<value_t const*>& out) const {
+            auto const hashes = hash(recs);
+            each(recs.data(), hashes.data(), recs.size(), [&out](value_t const& v) { out.push_back(&v); return true; });
+        }
+
+        void select(record_t const& rec, uint32_t const hash, std::vector<value_t const*>& out) const {
+            each(&rec, &hash, 1, [&out](value_t const& v) { out.push_back(&v); return true; });
+        }
+
+        void select(range_t const& r, std::vector<value_t const*>& out) const {
+            std::vector<uint32_t> scratch;
+            select(r, out, scratch);
+        }
+
+        // an ordered index gives the matches in value order, scratch sorts their positions back to array order
+        void select(range_t const& r, std::vector<value_t const*>& out, std::vector<uint32_t>& scratch) const {
+            if (auto const* ix = index(r.key.name, field_index_t::kind_t::ordered)) {
+                auto const [b, e] = ix->range(r);
+                scratch.clear();
+                for (auto const* x = b; x != e; x++)
+                    scratch.push_back(x->pos);
+                std::sort(scratch.begin(), scratch.end());
+                for (auto const pos : scratch)
+                    out.push_back(values[pos - 1].get());
+                return;
+            }
+            for (auto const& v : values) {
+                if (in(*v, r))
+                    out.push_back(v.get());
+            }
+        }
 
     private:
         value_t const* _find(size_t const i) const { return i < values.size() ? values[i].get() : nullptr; }
@@ -565,35 +1079,140 @@ namespace json {
         }
 
         value_t const* _find(std::vector<record_t> const& recs, bool const _explicit = true) const {
-            auto vit = std::find_if(values.begin(), values.end(), [recs, _explicit](std::unique_ptr<value_t> const& v) {
-                if (auto const* obj = v->get_if_object())
-                    return obj->has(recs);
-                return false;
-            });
+            auto const hashes = hash(recs);
+            value_t const* res = nullptr;
+            each(recs.data(), hashes.data(), recs.size(), [&res](value_t const& v) { res = &v; return false; });
+            return res;
+        }
+
+        value_t const* _find(range_t const& r) const {
+            auto const* ix = index(r.key.name, field_index_t::kind_t::ordered);
+            auto const [b, e] = ix ? ix->range(r) : std::pair<field_index_t::entry_t const*, field_index_t::entry_t const*>{};
+            // the first in array order: the smallest position of k entries, or a scan that meets
+            // a match every n/k elements - the scan wins for wide ranges
+            if (ix && size_t(e - b) * size_t(e - b) <= values.size() * 16) {
+                uint32_t pos = 0;
+                for (auto const* x = b; x != e; x++) {
+                    if (!pos || x->pos < pos)
+                        pos = x->pos;
+                }
+                return pos ? values[pos - 1].get() : nullptr;
+            }
+            auto vit = std::find_if(values.begin(), values.end(), [&r](node_ptr<value_t> const& v) { return in(*v, r); });
             return vit != values.end() ? vit->get() : nullptr;
         }
 
+        static bool in(value_t const& v, range_t const& r) {
+            if (auto const* obj = v.get_if_object()) {
+                if (auto const* p = (*obj)(r.key); p && p->get_value().is_number())
+                    return r.has(p->get_value().get<double>());
+            }
+            return false;
+        }
+
+        // a complete index on field of that kind
+        field_index_t const* index(std::string_view const field, field_index_t::kind_t const kind) const {
+            for (auto const* ix = indices.get(); ix; ix = ix->other.get()) {
+                if (ix->get_kind() == kind && ix->field().name == field)
+                    return ix->size() == values.size() ? ix : nullptr;
+            }
+            return nullptr;
+        }
+
+        static std::vector<uint32_t> hash(std::vector<record_t> const& recs) { // once, not per element
+            std::vector<uint32_t> hashes;
+            hashes.reserve(recs.size());
+            for (auto const& rec : recs)
+                hashes.push_back(fnv1a_32_2(rec.first.data(), rec.first.size()));
+            return hashes;
+        }
+
+        // f(value_t const&) for the elements matching all n recs (names hashed in hashes) in array order,
+        // until it returns false
+        template <typename F> void each(record_t const* recs, uint32_t const* hashes, size_t const n, F&& f) const {
+            auto const match = [recs, hashes, n](value_t const& v) {
+                if (auto const* obj = v.get_if_object()) {
+                    for (size_t i = 0; i < n; i++) {
+                        if (!obj->has(recs[i], hashes[i]))
+                            return false;
+                    }
+                    return true;
+                }
+                return false;
+            };
+            // a string record on an indexed field: only the elements with that value are tested
+            for (auto const* rec = recs; rec != recs + n; rec++) {
+                auto const* sv = std::get_if<std::string_view>(&rec->second);
+                if (auto const* ix = sv ? index(rec->first, field_index_t::kind_t::hash) : nullptr) {
+                    for (uint32_t pos = ix->find(values, *sv); pos; pos = ix->following(pos)) {
+                        if (match(*values[pos - 1]) && !f(*values[pos - 1]))
+                            return;
+                    }
+                    return;
+                }
+            }
+            for (auto const& v : values) {
+                if (match(*v) && !f(*v))
+                    return;
+            }
+        }
+
     private:
-        std::vector<std::unique_ptr<value_t>> values;
-        mutable std::unique_ptr<indices_t> indices;
+        std::pmr::vector<node_ptr<value_t>> values;
+        mutable node_ptr<field_index_t> indices; // list through field_index_t::other
     };
 
+    inline value_t::value_t(value_t const& v, names_t& names)
+        : source{ v.is_object() || v.is_array() ? std::string_view() : arena_str(names.resource(), v.source) }, type{ v.type }, escaped{ v.escaped } {
+        if (auto const* i = std::get_if<int64_t>(&v.value))
+            value = *i;
+        else if (auto const* u = std::get_if<uint64_t>(&v.value))
+            value = *u;
+        else if (auto const* d = std::get_if<double>(&v.value))
+            value = *d;
+        else if (auto* arr = v.get_if_array())
+            value = make_node<array_t>(names.resource(), *arr, names);
+        else if (auto* obj = v.get_if_object())
+            value = make_node<object_t>(names.resource(), *obj, names);
+    }
+
+    template <typename T> bool value_t::set(T const v) {
+        static_assert(std::is_arithmetic_v<T>, "value_t::set: number or bool");
+        if constexpr (std::is_same_v<T, bool>) {
+            value = v;
+            source = v ? "true" : "false";
+            type = type_t::boolean;
+        } else {
+            if constexpr (std::is_floating_point_v<T>) {
+                if (!std::isfinite(v)) // no json text for nan/inf
+                    return false;
+                value = static_cast<double>(v);
+            } else if constexpr (std::is_signed_v<T>)
+                value = static_cast<int64_t>(v);
+            else
+                value = static_cast<uint64_t>(v);
+            source = {};
+            type = type_t::number;
+        }
+        escaped = false;
+        return true;
+    }
+
+    // built part only, lazy containers are not expanded
     inline size_t value_t::memory() const {
         size_t mem = sizeof(value_t);
-        if (store.capacity())
-            mem += store.capacity();
-        if (auto* obj = get_if_object())
-            mem += obj->memory();
-        else if (auto* arr = get_if_array())
-            mem += arr->memory();
+        if (auto* obj = std::get_if<node_ptr<object_t>>(&value))
+            mem += (*obj)->memory();
+        else if (auto* arr = std::get_if<node_ptr<array_t>>(&value))
+            mem += (*arr)->memory();
         return mem;
     }
 
     inline void value_t::reindex() const {
-        if (auto* obj = get_if_object())
-            obj->reindex();
-        else if (auto* arr = get_if_array())
-            arr->reindex();
+        if (auto* obj = std::get_if<node_ptr<object_t>>(&value))
+            (*obj)->reindex();
+        else if (auto* arr = std::get_if<node_ptr<array_t>>(&value))
+            (*arr)->reindex();
     }
 
     inline value_t const* value_t::_find(size_t const i) const {
@@ -608,14 +1227,14 @@ namespace json {
         return nullptr;
     }
 
-    inline value_t const* value_t::_find(std::string_view const name) const {
+    inline value_t const* value_t::_find(hkey_t const& key) const {
         if (auto* o = get_if_object()) {
-            auto* p = (*o)(name);
+            auto* p = (*o)(key);
             return p ? &p->get_value() : nullptr;
         } else if (auto* a = get_if_array()) {
             for (auto const& v : *a) { // _find
                 if (v->get_if_object())
-                    return (*v)(name);
+                    return (*v)(key);
             }
         }
         return nullptr;
@@ -630,6 +1249,12 @@ namespace json {
         return nullptr;
     }
 
+    inline value_t const* value_t::_find(range_t const& r) const {
+        if (auto* a = get_if_array())
+            return (*a)(r);
+        return nullptr;
+    }
+
     inline value_t* pair_t::operator () (std::string_view const name, std::vector<record_t> const& recs, bool const _explicit) {
         if (get_name() == name)
             return nullptr;
@@ -642,44 +1267,95 @@ namespace json {
         struct stub { int stub; };
     
     public:
+        // compile(path): the segments split once, names hashed, indexes and predicates parsed; immutable,
+        // one plan runs against any number of documents (and threads), running it allocates nothing
+        class plan_t {
+        public:
+            plan_t() = default;
+            plan_t(plan_t&&) = default;
+            plan_t& operator = (plan_t&&) = default;
+
+            std::string_view path() const { return text ? std::string_view(*text) : std::string_view(); }
+            size_t size() const { return steps.size(); }
+
+        private:
+            friend class jpath_t;
+
+            enum class op_t : uint8_t { name, index, equals, range };
+            struct step_t {
+                op_t op{ op_t::name };
+                int index{ 0 };
+                hkey_t key{ std::string_view() }; // name, equals: the member compared
+                std::vector<record_t> recs;       // equals: the one record, for nodes that take records
+                range_t range;
+            };
+
+        private:
+            std::unique_ptr<std::string> text; // the views point here, a move keeps them
+            std::vector<step_t> steps;
+        };
+
         value_t const& v() const { return *value; }
         jpath_t find(std::string_view const path) { // auto tags = split(path, "/@"); if (tag.starts_with('@'))
             if (!value)
                 return jpath_t(value);
+            return jpath_t(walk(value, path));
+        }
 
-            //var = nul,bol,num,str
-            //val = var,obj,arr
-            //arr = [*val]
-            //mbr = str:val
-            //obj = {*mbr}
-
-            // mbr=str:arr[int]
-
-            // /str/ obj[mbr:str=str], arr[obj:mbr[0]:str=str], any mbr:str=str, obj[] | arr[].obj[]
-
-            value_t const* v = value;
-            for (auto const sc: su::split(path, '/')) {
-                if (!v) break;
-                auto const dog = su::split(sc, '@');
-                if (dog.empty() || dog.size() > 2)
-                    break;
-                if (dog.size() == 1) {
-                    v = (*v)(dog.front());
-                } else if (auto const eq = su::split(dog.back(), '='); eq.size() == 2) {
-                    std::vector<record_t> recs;
-                    recs.emplace_back(eq.front(), eq.back()); // support diff types
-                    v = (*v)(recs);
-                } else {
-                    int index;
-                    auto const [ptr, ec] = std::from_chars(dog.back().data(), dog.back().data()+dog.back().size(), index, 10);
-                    if (ec == std::errc())
-                        v = (*v)(index);
-                    else
-                        v = (*v)(dog.back());
+        jpath_t find(plan_t const& plan) const { return jpath_t(value ? run(value, plan) : value); }
+
+        //var = nul,bol,num,str
+        //val = var,obj,arr
+        //arr = [*val]
+        //mbr = str:val
+        //obj = {*mbr}
+
+        // mbr=str:arr[int]
+
+        // /str/ obj[mbr:str=str], arr[obj:mbr[0]:str=str], any mbr:str=str, obj[] | arr[].obj[]
+        static plan_t compile(std::string_view const path);
+
+        // V: value_t const* or any node type with operator*, operator () (name|index|recs|range) and explicit bool (tape_t::node_t)
+        template <typename V> static V walk(V v, std::string_view const path) { return run(v, compile(path)); }
+
+        template <typename V> static V run(V v, plan_t const& plan) { return run(v, plan.steps.data(), plan.steps.size()); }
+
+        // every element the last segment selects (@name=value, a range like @price<10), in array order;
+        // a last segment without a predicate gives what find() does, if anything
+        std::vector<value_t const*> select(std::string_view const path) const {
+            std::vector<value_t const*> res;
+            select(compile(path), res);
+            return res;
+        }
+
+        std::vector<value_t const*> select(plan_t const& plan) const {
+            std::vector<value_t const*> res;
+            select(plan, res);
+            return res;
+        }
+
+        void select(plan_t const& plan, std::vector<value_t const*>& out) const {
+            std::vector<uint32_t> scratch;
+            select(plan, out, scratch);
+        }
+
+        // appends to out, a reused out (and scratch, for an indexed range) allocates nothing
+        void select(plan_t const& plan, std::vector<value_t const*>& out, std::vector<uint32_t>& scratch) const {
+            size_t const n = plan.steps.size();
+            auto const* v = value && n ? run(value, plan.steps.data(), n - 1) : value;
+            if (v && n) {
+                auto const& last = plan.steps[n - 1];
+                if (auto const* arr = v->get_if_array(); arr && last.op == plan_t::op_t::equals) {
+                    arr->select(last.recs.front(), last.key.hash, out);
+                    return;
+                } else if (arr && last.op == plan_t::op_t::range) {
+                    arr->select(last.range, out, scratch);
+                    return;
                 }
+                v = step(v, last);
             }
-
-            return jpath_t(v);
+            if (v)
+                out.push_back(v);
         }
 
         operator int stub::* () const { // explicit bool
@@ -708,10 +1384,13 @@ namespace json {
             return res;
         }
 
-        template <typename T> T get(std::string_view const name) const {
+        template <typename T> T get(std::string_view const name) const { return get<T>(hkey_t(name)); }
+
+        // factories: jp.get<int>("i"_key) - the hash is a constant, lookup is a probe plus one compare
+        template <typename T> T get(hkey_t const& key) const {
             if (value) {
                 if (auto const* obj = value->get_if_object()) {
-                    if (auto const* p = (*obj)(name)) {
+                    if (auto const* p = (*obj)(key)) {
                         return p->get_value().get<T>();
                     }
                 }
@@ -730,42 +1409,138 @@ namespace json {
         friend class doc_t;
         jpath_t(value_t const* v, std::mutex* m = nullptr) : value(v), locker(m) {}
 
-        object_t const* _get_object() const {
-            auto* ptr = std::get_if<std::unique_ptr<object_t>>(&v().data());
-            return ptr ? ptr->get() : nullptr;
+        template <typename V> static V run(V v, plan_t::step_t const* s, size_t n) {
+            for (; n && v; s++, n--)
+                v = step(v, *s);
+            return v;
         }
 
-        array_t const* _get_array() const {
-            auto* ptr = std::get_if<std::unique_ptr<array_t>>(&v().data());
-            return ptr ? ptr->get() : nullptr;
+        // value_t: hashed lookups as compiled; other nodes get the name and the records
+        template <typename V> static V step(V const v, plan_t::step_t const& s) {
+            constexpr bool value_ptr = std::is_same_v<V, value_t const*>;
+            switch (s.op) {
+            case plan_t::op_t::name:
+                if constexpr (value_ptr)
+                    return (*v)(s.key);
+                else
+                    return (*v)(s.key.name);
+            case plan_t::op_t::index:
+                return (*v)(s.index);
+            case plan_t::op_t::equals:
+                if constexpr (value_ptr) {
+                    auto const* arr = v->get_if_array();
+                    return arr ? arr->find(s.recs.front(), s.key.hash) : nullptr;
+                } else
+                    return (*v)(s.recs);
+            case plan_t::op_t::range:
+                return (*v)(s.range);
+            }
+            return V();
         }
 
+        object_t const* _get_object() const { return v().get_if_object(); }
+        array_t const* _get_array() const { return v().get_if_array(); }
+
     private:
         value_t const* value;
         std::mutex* locker;
     };
 
+    struct options_t {
+        bool local{ false };   // copy strings into the document arena, the source may go away after parsing
+        bool numbers{ false }; // decode numbers while scanning them (exact int64_t/uint64_t/double), get<> becomes a load
+        std::pmr::memory_resource* upstream{ nullptr }; // where the doc arena (and the arena object) takes its blocks from, must outlive the doc (default: heap)
+        unsigned threads{ 1 }; // > 1: large arrays/objects are split and parsed by that many threads, 0 = hardware_concurrency
+        // containers are only bracket-matched, each is built on first touch (find, get_if_*, iteration, serialize);
+        // other errors inside a container throw std::runtime_error from that touch - doc_t::build() expands
+        // the whole tree up front and returns the error instead (the no-throw parse of untrusted input)
+        bool lazy{ false };
+        bool utf8{ false };    // validate the whole input as UTF-8 first (simd::validate_utf8), untrusted sources
+    };
+
+    // whole file mapped read-only, unmapped with the object (doc_t::load_file keeps it as the doc source)
+    class mapped_file_t {
+    public:
+        enum flags_t : unsigned {
+            sequential = 1, // MADV_SEQUENTIAL + MADV_WILLNEED: read-ahead for the single parse pass
+            populate = 2,   // MAP_POPULATE: fault the whole file in up front
+            huge = 4,       // MADV_HUGEPAGE: fewer TLB misses on big files (needs THP for the file system)
+        };
+
+        static std::unique_ptr<mapped_file_t> open(char const* path, unsigned const flags = sequential); // nullptr on failure, see errno
+        mapped_file_t(mapped_file_t const&) = delete;
+        ~mapped_file_t();
+
+        std::string_view view() const noexcept { return { static_cast<char const*>(addr), size }; }
+
+    private:
+        mapped_file_t(void* const a, size_t const s) : addr{ a }, size{ s } {}
+
+        void* addr;
+        size_t size;
+    };
+
+    struct result_t;
+
     class doc_t {
-        doc_t(std::unique_ptr<value_t>&& v) : root(std::move(v)) {}
+        explicit doc_t(value_t const& v) : arena{ make_arena(v.memory()) } {
+            names = make_node<names_t>(arena.get(), arena.get());
+            root = make_node<value_t>(arena.get(), v, *names);
+        }
 
     public:
         //enum storage_mode_t { local, external };
 
         doc_t() = default;
-        doc_t(doc_t&&) = default;
+        doc_t(doc_t&& d) noexcept : arena{ std::move(d.arena) }, names{ std::move(d.names) }, shards{ std::move(d.shards) }, lazy{ std::move(d.lazy) }, owner{ d.owner }, root{ std::move(d.root) }, text{ std::move(d.text) }, file{ std::move(d.file) } {}
         doc_t(doc_t const&) = delete;
-        doc_t(std::string&& src) : text{ std::move(src) } { if (auto [ok, v] = parse(text, false); ok) root = std::move(v); }
-        explicit doc_t(std::string_view const src, bool const local = true) { if (auto [ok, v] = parse(src, local); ok) root = std::move(v); }
-        explicit doc_t(std::string const& src, bool const local = true) { if (auto [ok, v] = parse(src, local); ok) root = std::move(v); }
+        doc_t(std::string&& src) : text{ std::make_unique<std::string>(std::move(src)) } { load(*text, options_t{}); }
+        doc_t(std::string&& src, options_t const& opt) : text{ std::make_unique<std::string>(std::move(src)) } { load(*text, opt); }
+        explicit doc_t(std::string_view const src, bool const local = true) { load(src, options_t{ local }); }
+        explicit doc_t(std::string const& src, bool const local = true) { load(src, options_t{ local }); }
+        doc_t(std::string_view const src, options_t const& opt) { load(src, opt); }
+        ~doc_t() { root.release(); names.release(); } // nodes own nothing outside of the arena, skip the per-node teardown
+
+        doc_t& operator = (doc_t&& d) noexcept {
+            root.release();
+            names.release();
+            arena = std::move(d.arena);
+            names = std::move(d.names);
+            shards = std::move(d.shards);
+            lazy = std::move(d.lazy);
+            owner = d.owner;
+            root = std::move(d.root);
+            text = std::move(d.text);
+            file = std::move(d.file);
+            return *this;
+        }
+
+        // non-throwing parse: the error carries kind and offset, doc is empty on failure
+        // string_view source is referenced unless opt.local, keep it alive as long as the doc
+        static result_t parse(std::string_view const src, options_t const& opt = options_t{});
+        // lazy mode: builds every container now, the first error inside one is returned instead of thrown later
+        parse_error_t build() const { return root ? root->build() : parse_error_t{}; }
+        // zero-copy file load: the doc owns the mapping its string views point into
+        // (opt.local copies the strings and unmaps right after parsing), errc_t::io if it can't be mapped
+        static result_t load_file(char const* path, options_t const& opt = options_t{}, unsigned const map = mapped_file_t::sequential);
 
-        void serialize(FILE* f);
+        // pretty (tabs) or compact text through writer_t, see writer.h for other sinks
+        void serialize(FILE* f, bool const pretty = true) const;
+        void serialize(std::string& out, bool const pretty = true) const;
 
         jpath_t find(std::string_view const path) const { return jpath_t(root.get()).find(path); }
-        doc_t clone() const { return doc_t(std::make_unique<value_t>(*root)); }
+        jpath_t find(jpath_t::plan_t const& plan) const { return jpath_t(root.get()).find(plan); }
+        std::vector<value_t const*> select(std::string_view const path) const { return jpath_t(root.get()).select(path); }
+        std::vector<value_t const*> select(jpath_t::plan_t const& plan) const { return jpath_t(root.get()).select(plan); }
+        doc_t clone() const { return root ? doc_t(*root) : doc_t(); }
 
-        size_t memory() const { return root ? root->memory() : 0; }
+        size_t memory() const { return (root ? root->memory() : 0) + (names ? names->memory() : 0); }
         void reindex() const { if (root) root->reindex(); }
-        bool make_index(std::string_view const path); // islands/territories/buildings/_id ; "buildings:[{_id:value1},{id:value2}]"
+        // islands/territories/buildings/_id: every array the path prefix reaches (all elements of the arrays on the way)
+        // is indexed on the last segment, find() answers @_id=value2 on them by a hash probe; false if no array was reached
+        // ordered: a sorted column of the numbers instead, for range segments (@level>=5) in find() and select()
+        // "buildings:[{_id:value1},{id:value2}]"
+        bool make_index(std::string_view const path, bool const ordered = false);
 
         // ?move to jpath_t
         template <typename T> std::vector<T> get_array(std::string_view const path, bool const _explicit = true) {
@@ -860,34 +1635,112 @@ namespace json {
         }
 
     private:
-        void makeError(std::string_view error, reader_t const& reader) const;
-
-        std::pair<bool, std::unique_ptr<value_t>> parse(std::string_view const data, bool const local);
-        bool parse_ws(reader_t& rd);
-        bool parse_comma(reader_t& rd);
-        std::pair<bool, std::string_view> parse_null(reader_t& rd);
-        std::pair<bool, std::string_view> parse_false(reader_t& rd);
-        std::pair<bool, std::string_view> parse_true(reader_t& rd);
-        std::pair<bool, std::string_view> parse_bool(reader_t& rd);
-        std::pair<bool, std::string_view> parse_number(reader_t& rd);
-        std::tuple<bool, std::string_view, bool> parse_string(reader_t& rd);
-        std::pair<bool, std::unique_ptr<value_t>> parse_value(reader_t& rd, bool const local);
-        std::pair<bool, std::unique_ptr<array_t>> parse_array(reader_t& rd, bool const local);
-        std::pair<bool, pair_t> parse_member(reader_t& rd, bool const local);
-        std::pair<bool, std::unique_ptr<object_t>> parse_object(reader_t& rd, bool const local);
-
-        void serialize(FILE* f, std::string indent, std::string_view const value);
-        void serialize(FILE* f, std::string indent, bool const value);
-        void serialize(FILE* f, std::string indent, value_t const& value, bool const skipIndent = false);
-        void serialize(FILE* f, std::string indent, array_t const& array);
-        void serialize(FILE* f, std::string indent, pair_t const& pair);
-        void serialize(FILE* f, std::string indent, object_t const& object);
+        friend class tape_t;
+        friend class stream_t;
+        friend class sax_t;
+        friend class projection_t;
+        friend class lazy_t;
+        friend class bjson_t;
+
+        // the name table is made on the first member, in the current arena
+        name_t const* intern(std::string_view const raw, bool const copy) {
+            if (!names)
+                names = make_node<names_t>(arena.get(), arena.get());
+            return names->intern(raw, copy);
+        }
+
+        static void makeError(errc_t const code, char const* error, reader_t& rd);
+        [[noreturn]] static void throwError(reader_t const& rd);
+
+        std::string_view prepare(std::string_view const data, options_t const& opt);
+        void load(std::string_view const data, options_t const& opt);
+        parse_error_t try_load(std::string_view const data, options_t const& opt);
+        std::pair<bool, node_ptr<value_t>> parse_root(reader_t& rd, options_t const& opt);
+        static bool check_utf8(reader_t& rd, options_t const& opt);
+        static bool parse_ws(reader_t& rd);
+        static bool parse_comma(reader_t& rd);
+        static std::pair<bool, std::string_view> parse_null(reader_t& rd);
+        static std::pair<bool, std::string_view> parse_false(reader_t& rd);
+        static std::pair<bool, std::string_view> parse_true(reader_t& rd);
+        static std::pair<bool, std::string_view> parse_bool(reader_t& rd);
+        static std::pair<bool, std::string_view> parse_number(reader_t& rd, number_t* num = nullptr);
+        static std::tuple<bool, std::string_view, bool> parse_string(reader_t& rd);
+        std::pair<bool, node_ptr<value_t>> parse_value(reader_t& rd, options_t const& opt);
+        std::pair<bool, node_ptr<array_t>> parse_array(reader_t& rd, options_t const& opt);
+        std::pair<bool, pair_t> parse_member(reader_t& rd, options_t const& opt);
+        std::pair<bool, node_ptr<object_t>> parse_object(reader_t& rd, options_t const& opt);
+
+        // parallel mode (options_t::threads): structural pre-pass + per-thread arenas
+        static constexpr size_t parallel_bytes = 1 << 20; // smaller containers are parsed by the calling thread
+        static bool split(reader_t const& rd, char const close, std::vector<std::pair<size_t, size_t>>& items, size_t& end);
+        bool parse_parallel(reader_t& rd, options_t const& opt, array_t* array, object_t* object, options_t& sub);
 
     private:
-        std::unique_ptr<value_t> root;
-        std::string text; // if all sv's are empty -> text.clear
-        std::mutex locker;
+        arena_ptr arena; // must outlive root
+        node_ptr<names_t> names; // member names of this doc's parse, in arena
+        std::vector<arena_ptr> shards; // arenas of the parallel parse workers, must outlive root
+        size_t prescan{ 0 }; // bytes the parallel pre-pass looked at during the parse, bounded by the text size
+        std::unique_ptr<lazy_t> lazy; // lazy mode: builds the containers into its own arena, must outlive root
+        lazy_t* owner{ nullptr };     // lazy mode: containers parsed by this doc are left to it
+        node_ptr<value_t> root;
+        std::unique_ptr<std::string> text; // owned source, heap-pinned so views into it survive a move; if all sv's are empty -> text.reset
+        std::unique_ptr<mapped_file_t> file; // owned source of load_file
+        std::mutex locker; // not moved, each doc_t has its own
         //std::vector<std::string> storage; // remove store from value
     };
 
+    struct result_t {
+        doc_t doc;
+        parse_error_t error;
+
+        explicit operator bool() const noexcept { return !error; }
+    };
+
+    // lazy mode context, one per doc: a container is built one level at a time, its children stay lazy
+    // an error inside a container only shows up when it is built: std::runtime_error from the accessor,
+    // or the parse_error_t of value_t::build() / doc_t::build()
+    // builds are serialized, so threads may expand different subtrees; like the decoded number cache,
+    // a container must not be touched for the first time by two threads at once
+    class lazy_t {
+    public:
+        lazy_t(std::string_view const src, options_t const& o);
+
+        void load(value_t const& v);
+        parse_error_t try_load(value_t const& v);
+
+    private:
+        friend class doc_t;
+
+        void parse(value_t const& v, reader_t& rd);
+
+        doc_t parser; // arena of the built containers
+        std::string_view text;
+        options_t opt;
+        std::mutex locker;
+    };
+
+    inline void value_t::expand() const {
+        if (auto* lazy = std::get_if<lazy_t*>(&value))
+            (*lazy)->load(*this);
+    }
+
+    inline parse_error_t value_t::build(bool const deep) const {
+        if (auto* lazy = std::get_if<lazy_t*>(&value)) {
+            if (auto const err = (*lazy)->try_load(*this))
+                return err;
+        }
+        if (auto* obj = std::get_if<node_ptr<object_t>>(&value); obj && deep) {
+            for (auto const& p : **obj) {
+                if (auto const err = p.get_value().build())
+                    return err;
+            }
+        } else if (auto* arr = std::get_if<node_ptr<array_t>>(&value); arr && deep) {
+            for (auto const& v : **arr) {
+                if (auto const err = v->build())
+                    return err;
+            }
+        }
+        return {};
+    }
+
 }
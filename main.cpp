@@ -1,3 +1,4 @@
+#include <charconv>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
@@ -16,7 +17,6 @@
 
 #include "json.h"
 #include "timer.h"
-#include "mmap.h"
 #include "fnv.h"
 
 struct SubClass {
@@ -39,6 +39,17 @@ private:
     int64_t ts{0};
 };
 
+static void collect_numbers(json::value_t const& v, std::vector<std::string_view>& out) {
+    if (auto const* obj = v.get_if_object()) {
+        for (size_t i = 0; i < obj->size(); i++)
+            collect_numbers((*obj)[i].get_value(), out);
+    } else if (auto const* arr = v.get_if_array()) {
+        for (size_t i = 0; i < arr->size(); i++)
+            collect_numbers((*arr)[i], out);
+    } else if (v.is_number())
+        out.push_back(v.get_raw_str());
+}
+
 int main() {
     //std::string text{ " null " };
     //std::string text{ "true" };
@@ -120,28 +131,58 @@ int main() {
         // parse file=67, mmap=73, serialization=93ms, clone=44
 
         auto f3 = tmx::ms();
-        int fd = _open("test/sample0.json", _O_BINARY | _O_RDONLY);
-        size_t length = _filelength(fd);
-        char const* ptr = static_cast<char const*>(mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0));
-        _close(fd);
-        std::string_view sv(ptr, length);
-        json::doc_t mdoc(sv, true);
+        auto mres = json::doc_t::load_file("test/sample0.json"); // mapping owned by the doc, values point into it
         f3 = tmx::ms() - f3;
-        munmap(static_cast<void*>(const_cast<char*>(ptr)), length);
+        if (!mres) {
+            std::cout << "load_file failed: " << mres.error.what << std::endl;
+            return -3;
+        }
+        auto& mdoc = mres.doc;
 
         std::cout << "parse mmap ms: " << f3 << "; doc mem: " << mdoc.memory() << std::endl;
         // parse file=67ms, mmap=73ms, clone=45ms, mem=48.79MB
 
+        { // number text <-> double: json::parse_double/format vs std::from_chars/to_chars
+            std::vector<std::string_view> nums;
+            collect_numbers(mdoc.find("").v(), nums);
+            std::vector<double> vals(nums.size());
+            char buf[json::number_chars];
+            size_t std_chars = 0, json_chars = 0; // shortest both, json omits the exponent up to 1e21
+
+            auto n0 = tmx::mks();
+            for (size_t i = 0; i < nums.size(); i++)
+                std::from_chars(nums[i].data(), nums[i].data() + nums[i].size(), vals[i]);
+            n0 = tmx::mks() - n0;
+            auto n1 = tmx::mks();
+            for (size_t i = 0; i < nums.size(); i++)
+                json::parse_double(nums[i].data(), nums[i].data() + nums[i].size(), vals[i]);
+            n1 = tmx::mks() - n1;
+            auto n2 = tmx::mks();
+            for (double const d : vals)
+                std_chars += std::to_chars(buf, buf + sizeof(buf), d).ptr - buf;
+            n2 = tmx::mks() - n2;
+            auto n3 = tmx::mks();
+            for (double const d : vals)
+                json_chars += json::format(d, buf) - buf;
+            n3 = tmx::mks() - n3;
+
+            std::cout << "numbers: " << nums.size() << "; from_chars mks: " << n0 << "; parse_double mks: " << n1
+                << "; to_chars mks: " << n2 << " (" << std_chars << "); format mks: " << n3 << " (" << json_chars << ")" << std::endl;
+        }
+
         auto res = doc.find("Image/Thumbnail/Url");
         auto res_obj = doc.get_array<Provider>("game/EndingTimeProvider/dict");
         auto res_str = doc.get_array<std::string_view>("game/ShopSlotBadgeState/SavedInfoStorage/Forest/Unlocked");
-        auto buildings = doc.find("islands/@territories/@buildings/@_id=value2");
+        doc.make_index("islands/territories/buildings/_id"); // @_id=value lookups become hash probes
+        static auto const building = json::jpath_t::compile("islands/@territories/@buildings/@_id=value2"); // parsed once, reused
+        auto buildings = doc.find(building);
         //a/b/c {a: {b: {c:...}...}}
         //a/@b/@c {a: [{b:[{c:...}...]}]}
         // /@+-#/ /@name/ /*@/
         //a.@b.@c.@-1.@0.*@.*@
 
         {
+            using namespace json::literals;
             class base_t {
             public:
                 base_t() = default;
@@ -152,9 +193,9 @@ int main() {
                 friend class factory_t;
                 friend class json::jpath_t;
                 cname(json::jpath_t const jp)
-                    : i{ jp.get<int>("i") }
-                    , f{ jp.get<double>("f") }
-                    , s{ jp.get<std::string_view>("s") }
+                    : i{ jp.get<int>("i"_key) } // hashed at compile time
+                    , f{ jp.get<double>("f"_key) }
+                    , s{ jp.get<std::string_view>("s"_key) }
                 {}
             public:
                 cname() = default;
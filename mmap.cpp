@@ -1,9 +1,19 @@
 #include "mmap.h"
+#include "json.h"
 
+#ifdef _WIN32
 #include <assert.h>
+#include <fcntl.h>
 #include <io.h>
 #include <windows.h>
 #include <unordered_map>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
 
 static std::unordered_map<void*, std::pair<HANDLE, size_t>> s_mmap_handles;
 
@@ -147,3 +157,50 @@ int munmap(void* addr, size_t length) {
 
     return 0;
 }
+
+int madvise(void* addr, size_t length, int advice) {
+    return 0;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+#ifdef _WIN32
+    int open_file(char const* path) { return _open(path, _O_BINARY | _O_RDONLY); }
+    long long file_size(int const fd) { return _filelengthi64(fd); }
+    void close_file(int const fd) { _close(fd); }
+#else
+    int open_file(char const* path) { return ::open(path, O_RDONLY | O_CLOEXEC); }
+    long long file_size(int const fd) { struct stat st; return fstat(fd, &st) ? -1 : static_cast<long long>(st.st_size); }
+    void close_file(int const fd) { ::close(fd); }
+#endif
+}
+
+std::unique_ptr<json::mapped_file_t> json::mapped_file_t::open(char const* path, unsigned const flags) {
+    int const fd = open_file(path);
+    if (fd < 0)
+        return nullptr;
+    long long const size = file_size(fd);
+    if (size <= 0) {
+        close_file(fd);
+        return size ? nullptr : std::unique_ptr<mapped_file_t>(new mapped_file_t(nullptr, 0)); // mmap refuses empty files
+    }
+    void* const addr = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE | (flags & populate ? MAP_POPULATE : 0), fd, 0);
+    close_file(fd); // the mapping keeps the file open
+    if (addr == MAP_FAILED)
+        return nullptr;
+    // hints only, failures don't matter
+    if (flags & sequential) {
+        madvise(addr, static_cast<size_t>(size), MADV_SEQUENTIAL);
+        madvise(addr, static_cast<size_t>(size), MADV_WILLNEED);
+    }
+    if (flags & huge)
+        madvise(addr, static_cast<size_t>(size), MADV_HUGEPAGE);
+    return std::unique_ptr<mapped_file_t>(new mapped_file_t(addr, static_cast<size_t>(size)));
+}
+
+json::mapped_file_t::~mapped_file_t() {
+    if (addr)
+        munmap(addr, size);
+}
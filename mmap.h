@@ -2,6 +2,11 @@
 #ifndef mmap_h__
 #define mmap_h__
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#else
+// posix mmap emulation for windows
+
 #include <sys/types.h>
 
 #define MAP_FAILED       ((void*) -1)
@@ -25,9 +30,19 @@
 #define MAP_FILE         0x0000
 #define MAP_ANON         0x1000
 #define MAP_ANONYMOUS    MAP_ANON
+#define MAP_POPULATE     0x0000 // no-op
+
+#define MADV_NORMAL      0
+#define MADV_RANDOM      1
+#define MADV_SEQUENTIAL  2
+#define MADV_WILLNEED    3
+#define MADV_HUGEPAGE    14
 
 //void* mmap64(void* start, size_t length, int prot, int flags, int fd, off64_t offset); // android api >= 21
 void* mmap(void* start, size_t length, int prot, int flags, int fd, off_t offset);
 int munmap(void* addr, size_t length);
+int madvise(void* addr, size_t length, int advice); // no-op
+
+#endif
 
 #endif
@@ -0,0 +1,165 @@
+#include "ndjson.h"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace json;
+
+namespace {
+
+    constexpr size_t batch_bytes = 1 << 20;
+
+    struct batch_t {
+        std::string_view text;
+        std::unique_ptr<arena_t> arena; // must outlive docs
+        std::vector<std::pair<size_t, result_t>> docs; // line within the batch, record
+        size_t lines{ 0 };
+        bool ready{ false };
+    };
+
+    // ~batch_bytes slices of src, each ends right after a '\n' (or at the end of src)
+    std::vector<batch_t> cut(std::string_view const src) {
+        std::vector<batch_t> res;
+        for (size_t pos = 0; pos < src.size(); ) {
+            size_t end = std::min(src.size(), pos + batch_bytes);
+            if (end < src.size())
+                end = std::min(src.size(), simd::find_char(src.data(), end, src.size(), '\n') + 1);
+            res.emplace_back().text = src.substr(pos, end - pos);
+            pos = end;
+        }
+        return res;
+    }
+
+    void parse_batch(batch_t& b, options_t opt) {
+        opt.upstream = b.arena.get();
+        char const* const data = b.text.data();
+        size_t const size = b.text.size();
+        for (size_t pos = 0; pos < size; b.lines++) {
+            size_t const nl = simd::find_char(data, pos, size, '\n');
+            if (simd::skip_ws(data, pos, nl) < nl) // skip blank lines
+                b.docs.emplace_back(b.lines, doc_t::parse(b.text.substr(pos, nl - pos), opt));
+            pos = nl + 1;
+        }
+    }
+
+    // batches are parsed by the workers and handed to consume() in input order on the calling thread
+    // recycle: a consumed batch gives its arena back, workers stay at most `window` batches ahead
+    template <typename F> void run(std::string_view const src, options_t const& opt, unsigned threads, bool const recycle, F&& consume) {
+        auto batches = cut(src);
+        if (batches.empty())
+            return;
+        if (!threads)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<size_t>(threads, batches.size()));
+        size_t const window = recycle ? size_t(threads) * 4 : batches.size();
+
+        std::mutex m;
+        std::condition_variable cv;
+        std::vector<std::unique_ptr<arena_t>> pool;
+        size_t next = 0, consumed = 0;
+        bool stop = false;
+        std::exception_ptr failed; // first worker exception (bad_alloc, length_error), rethrown by the caller
+
+        auto worker = [&] {
+            while (true) {
+                std::unique_ptr<arena_t> arena;
+                size_t i;
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv.wait(lk, [&] { return stop || next >= batches.size() || next < consumed + window; });
+                    if (stop || next >= batches.size())
+                        return;
+                    i = next++;
+                    if (!pool.empty()) {
+                        arena = std::move(pool.back());
+                        pool.pop_back();
+                    }
+                }
+                try {
+                    if (!arena)
+                        arena = std::make_unique<arena_t>(batches[i].text.size() * 3 + 4096);
+                    batches[i].arena = std::move(arena);
+                    parse_batch(batches[i], opt);
+                } catch (...) {
+                    {
+                        std::lock_guard<std::mutex> lk(m);
+                        if (!failed)
+                            failed = std::current_exception();
+                        stop = true;
+                    }
+                    cv.notify_all();
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lk(m);
+                    batches[i].ready = true;
+                }
+                cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++)
+            workers.emplace_back(worker);
+
+        std::exception_ptr ex;
+        try {
+            for (size_t i = 0; i < batches.size(); i++) {
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv.wait(lk, [&] { return batches[i].ready || stop; });
+                    if (!batches[i].ready) // a worker failed
+                        break;
+                }
+                consume(batches[i]);
+                if (recycle) {
+                    batches[i].docs.clear();
+                    batches[i].docs.shrink_to_fit();
+                    batches[i].arena->release();
+                }
+                {
+                    std::lock_guard<std::mutex> lk(m);
+                    if (recycle)
+                        pool.push_back(std::move(batches[i].arena));
+                    consumed = i + 1;
+                }
+                cv.notify_all();
+            }
+        } catch (...) {
+            ex = std::current_exception();
+            std::lock_guard<std::mutex> lk(m);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers)
+            w.join();
+        if (ex)
+            std::rethrow_exception(ex);
+        if (failed)
+            std::rethrow_exception(failed);
+    }
+
+}
+
+void json::for_each_line(std::string_view const src, line_fn const& fn, options_t const& opt, unsigned const threads) {
+    size_t base = 0;
+    run(src, opt, threads, true, [&](batch_t& b) {
+        for (auto& [line, res] : b.docs)
+            fn(base + line, res);
+        base += b.lines;
+    });
+}
+
+lines_t::lines_t(std::string_view const src, options_t const& opt, unsigned const threads) {
+    size_t base = 0;
+    run(src, opt, threads, false, [&](batch_t& b) {
+        for (auto& [line, res] : b.docs) {
+            lines.push_back(base + line);
+            docs.push_back(std::move(res));
+        }
+        base += b.lines;
+        arenas.push_back(std::move(b.arena));
+    });
+}
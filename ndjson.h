@@ -0,0 +1,49 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+// newline-delimited json (NDJSON / JSON Lines): one document per line, parsed by a worker pool
+// - the input is cut into ~1MB batches at '\n' boundaries, each batch parses into its own arena
+//   (options_t::upstream), the doc arena object included, so a record costs no heap allocation
+//   beyond its doc_t header (lazy mode: and its lazy_t context)
+// - an exception of a worker (bad_alloc, length_error) stops the pool and is rethrown to the caller
+// - results come back in input order, blank lines are skipped, a bad record fails alone
+// - unless options_t::local, docs reference src and it must outlive them
+
+namespace json {
+
+    using line_fn = std::function<void(size_t const line, result_t& res)>; // 0-based source line
+
+    // callback per record in input order, on the calling thread; res is only valid during the call,
+    // its batch arena is recycled afterwards, so memory stays bounded by the batches in flight
+    void for_each_line(std::string_view const src, line_fn const& fn, options_t const& opt = options_t{}, unsigned threads = 0);
+
+    // all records of src, kept together with the batch arenas they live in
+    class lines_t {
+    public:
+        explicit lines_t(std::string_view const src, options_t const& opt = options_t{}, unsigned threads = 0);
+        lines_t(lines_t&&) = default;
+        lines_t(lines_t const&) = delete;
+
+        size_t size() const noexcept { return docs.size(); }
+        result_t& operator [] (size_t const i) { return docs[i]; }
+        result_t const& operator [] (size_t const i) const { return docs[i]; }
+        size_t line(size_t const i) const { return lines[i]; } // 0-based source line of record i
+
+        auto begin() { return docs.begin(); }
+        auto end() { return docs.end(); }
+        auto begin() const { return docs.begin(); }
+        auto end() const { return docs.end(); }
+
+    private:
+        std::vector<std::unique_ptr<arena_t>> arenas; // must outlive docs
+        std::vector<result_t> docs;
+        std::vector<size_t> lines;
+    };
+
+}
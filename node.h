@@ -0,0 +1,114 @@
+#pragma once
+
+#include <charconv>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+// queries shared by the read-only node types (tape_t::node_t, bjson_t::node_t), written once against their interface:
+// explicit bool, is_*, size(), get<T>(), get_raw_str(), operator () (size_t|name), begin()/end() over the elements
+// (over the members of an object: operator * is the value, name() the unquoted name)
+// N derives from node_query_t<N> and pulls the operators in: using node_query_t<N>::operator ();
+
+namespace json {
+
+    template <typename N> class node_query_t {
+    public:
+        N operator () (int i) const {
+            if (i < 0) i = static_cast<int>(self().size()) + i;
+            return i >= 0 ? self()(static_cast<size_t>(i)) : N();
+        }
+
+        // the first object element with all recs
+        N operator () (std::vector<record_t> const& recs) const {
+            if (self().is_array()) {
+                for (auto const v : self())
+                    if (v.is_object() && v.has(recs))
+                        return v;
+            }
+            return N();
+        }
+
+        N operator () (range_t const& r) const {
+            if (self().is_array()) {
+                for (auto const v : self()) {
+                    if (!v.is_object())
+                        continue;
+                    if (auto const m = v(r.key.name); m && m.is_number() && r.has(m.template get<double>()))
+                        return v;
+                }
+            }
+            return N();
+        }
+
+        // every rec matched by some member of that name, like object_t::has
+        bool has(std::vector<record_t> const& recs) const {
+            for (auto const& rec : recs) {
+                bool found = false;
+                for (auto it = self().begin(); !found && it != self().end(); ++it)
+                    found = it.name() == rec.first && match(*it, rec);
+                if (!found)
+                    return false;
+            }
+            return true;
+        }
+
+        template <typename T> T str_as(T const def = T()) const {
+            if constexpr (std::is_same_v<T, std::string_view>) {
+                return self().is_number() ? self().get_raw_str() : self().template get<std::string_view>(def);
+            } else if constexpr (std::is_same_v<T, bool>) {
+                auto const s = self().template get<std::string_view>();
+                return s == "true" ? true : s == "false" ? false : def;
+            } else
+                return self().is_string() ? number<T>(self().template get<std::string_view>(), def) : def;
+        }
+
+        // elements of an array node as T, see doc_t::get_array
+        template <typename T> std::vector<T> get_array(bool const _explicit = true) const {
+            std::vector<T> res;
+            if (!self() || !self().is_array())
+                return res;
+            res.reserve(self().size());
+            for (auto const v : self()) {
+                if constexpr (std::is_same_v<T, std::string_view>) {
+                    if (v.is_string())
+                        res.emplace_back(v.template get<std::string_view>());
+                    else if (!_explicit && v.is_number())
+                        res.emplace_back(v.template str_as<std::string_view>());
+                } else if constexpr (std::is_arithmetic_v<T>) {
+                    if (v.is_number())
+                        res.emplace_back(v.template get<T>());
+                    else if (!_explicit && v.is_string())
+                        res.emplace_back(v.template str_as<T>());
+                } else if (v.is_object()) {
+                    res.push_back(T(v)); // T() due to T::cstr is private
+                }
+            }
+            return res;
+        }
+
+    protected:
+        template <typename T> static T number(std::string_view const src, T const def) {
+            T val;
+            auto const [ptr, ec] = std::from_chars(src.data(), src.data() + src.size(), val);
+            return ec == std::errc() ? val : def;
+        }
+
+    private:
+        N const& self() const { return static_cast<N const&>(*this); }
+
+        static bool match(N const& m, record_t const& rec) {
+            if (auto const* b = std::get_if<bool>(&rec.second))
+                return m.is_bool() && m.template get<bool>() == *b;
+            if (auto const* i = std::get_if<int64_t>(&rec.second))
+                return m.is_number() && m.template get<int64_t>() == *i;
+            if (auto const* d = std::get_if<double>(&rec.second))
+                return m.is_number() && m.template get<double>() == *d;
+            if (auto const* s = std::get_if<std::string_view>(&rec.second))
+                return m.is_string() && m.template get<std::string_view>() == *s;
+            return true; // only pair name case
+        }
+    };
+
+}
@@ -0,0 +1,456 @@
+#include "number.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+using namespace json;
+
+namespace {
+
+    constexpr char pairs[] =
+        "0001020304050607080910111213141516171819"
+        "2021222324252627282930313233343536373839"
+        "4041424344454647484950515253545556575859"
+        "6061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+    constexpr double exact_pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    // double layout
+    constexpr int mantissa_bits = 52;
+    constexpr uint64_t c_min = uint64_t(1) << mantissa_bits; // hidden bit
+    constexpr int q_min = -1074;                                // exponent of the smallest subnormal
+
+    inline bool is_digit(char const ch) { return static_cast<unsigned char>(ch - '0') < 10; }
+
+    // swar, little-endian: 8 digit characters at p
+    inline bool eight_digits(char const* const p) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return !(((v + 0x4646464646464646) | (v - 0x3030303030303030)) & 0x8080808080808080);
+    }
+
+    inline uint64_t parse_eight(char const* const p) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        v -= 0x3030303030303030;
+        v = v * 10 + (v >> 8); // digit pairs
+        return (((v & 0x000000FF000000FF) * 0x000F424000000064) + (((v >> 16) & 0x000000FF000000FF) * 0x0000271000000001)) >> 32;
+    }
+
+    inline int clz(uint64_t const v) { // v != 0
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long i;
+        _BitScanReverse64(&i, v);
+        return 63 - static_cast<int>(i);
+#elif defined(__GNUC__)
+        return __builtin_clzll(v);
+#else
+        int n = 0;
+        for (uint64_t m = uint64_t(1) << 63; !(v & m); m >>= 1)
+            n++;
+        return n;
+#endif
+    }
+
+    // high 64 bits of a * b, the low ones go to lo
+    inline uint64_t mul128(uint64_t const a, uint64_t const b, uint64_t& lo) {
+#if defined(_MSC_VER) && defined(_M_X64)
+        uint64_t hi;
+        lo = _umul128(a, b, &hi);
+        return hi;
+#elif defined(__SIZEOF_INT128__)
+        unsigned __int128 const p = static_cast<unsigned __int128>(a) * b;
+        lo = static_cast<uint64_t>(p);
+        return static_cast<uint64_t>(p >> 64);
+#else
+        uint64_t const a0 = static_cast<uint32_t>(a), a1 = a >> 32, b0 = static_cast<uint32_t>(b), b1 = b >> 32;
+        uint64_t const p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+        uint64_t const mid = (p00 >> 32) + static_cast<uint32_t>(p01) + static_cast<uint32_t>(p10);
+        lo = (mid << 32) | static_cast<uint32_t>(p00);
+        return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+    }
+
+    // little-endian 32-bit limbs, just the arithmetic the tables are built with
+    struct big_t {
+        std::vector<uint32_t> d;
+
+        explicit big_t(size_t const pow2) : d(pow2 / 32 + 1) { d.back() = uint32_t(1) << pow2 % 32; }
+
+        size_t bits() const {
+            size_t n = d.size() * 32;
+            for (uint32_t top = d.back(); !(top & 0x80000000u); top <<= 1)
+                n--;
+            return n;
+        }
+        bool bit(ptrdiff_t const i) const { return i >= 0 && static_cast<size_t>(i) < d.size() * 32 && (d[i / 32] >> i % 32 & 1); }
+        uint64_t word(ptrdiff_t const at) const { // bits [at, at + 64), zeros outside
+            uint64_t w = 0;
+            for (ptrdiff_t i = at + 63; i >= at; i--)
+                w = w << 1 | static_cast<uint64_t>(bit(i));
+            return w;
+        }
+
+        void mul(uint32_t const m) {
+            uint64_t c = 0;
+            for (auto& x : d) {
+                c += uint64_t(x) * m;
+                x = static_cast<uint32_t>(c);
+                c >>= 32;
+            }
+            if (c)
+                d.push_back(static_cast<uint32_t>(c));
+        }
+        void div(uint32_t const m) { // floor, floor(floor(x / a) / b) == floor(x / ab) lets quotients be chained
+            uint64_t r = 0;
+            for (size_t i = d.size(); i--;) {
+                r = r << 32 | d[i];
+                d[i] = static_cast<uint32_t>(r / m);
+                r %= m;
+            }
+            while (d.size() > 1 && !d.back())
+                d.pop_back();
+        }
+        big_t shr(size_t const n) const {
+            big_t r(0);
+            r.d.resize((bits() - n + 31) / 32);
+            for (size_t i = 0; i < r.d.size(); i++)
+                r.d[i] = static_cast<uint32_t>(word(static_cast<ptrdiff_t>(n + i * 32)));
+            return r;
+        }
+        void inc() {
+            for (auto& x : d)
+                if (++x)
+                    return;
+            d.push_back(1);
+        }
+    };
+
+    // 128-bit approximations of powers of ten
+    // - pow5[(q - pow5_min) * 2]: 5^q scaled into [2^127, 2^128) as Eisel-Lemire expects it (fast_float's table:
+    //   truncated, a negative power is floor + 1 of its quotient before the truncation)
+    // - g[(k - g_min) * 2]: 10^-k scaled into [2^125, 2^126), floor + 1, split into 63-bit halves (Schubfach)
+    struct powers_t {
+        static constexpr int pow5_min = -342, pow5_max = 308;
+        static constexpr int g_min = -324, g_max = 292;
+
+        uint64_t pow5[(pow5_max - pow5_min + 1) * 2];
+        uint64_t g[(g_max - g_min + 1) * 2];
+
+        powers_t() {
+            constexpr size_t B = 1760; // floor(2^B / 5^n) keeps > 128 bits for every n and covers fast_float's 2^b
+            big_t p5(0); // 5^n
+            big_t x(B);  // floor(2^B / 5^n)
+            for (int n = 0; n <= -pow5_min; n++) {
+                if (n) {
+                    p5.mul(5);
+                    x.div(5);
+                }
+                if (n <= pow5_max)
+                    top128(pow5 + (n - pow5_min) * 2, p5);
+                if (n) {
+                    size_t const z = p5.bits(); // smallest z with 2^z >= 5^n
+                    auto c = x.shr(B - (n <= 27 ? z + 127 : 2 * z + 128));
+                    c.inc();
+                    top128(pow5 + (-n - pow5_min) * 2, c);
+                }
+                if (-n >= g_min)
+                    top126(g + (-n - g_min) * 2, p5);
+                if (n && n <= g_max)
+                    top126(g + (n - g_min) * 2, x);
+            }
+        }
+
+        static void top128(uint64_t* const e, big_t const& v) {
+            auto const at = static_cast<ptrdiff_t>(v.bits()) - 128;
+            e[0] = v.word(at + 64);
+            e[1] = v.word(at);
+        }
+        static void top126(uint64_t* const e, big_t const& v) {
+            auto const at = static_cast<ptrdiff_t>(v.bits()) - 126;
+            uint64_t hi = v.word(at + 64), lo = v.word(at) + 1;
+            hi += !lo;
+            e[0] = hi << 1 | lo >> 63;
+            e[1] = lo & (~uint64_t(0) >> 1);
+        }
+    };
+
+    powers_t const& powers() {
+        static powers_t const p;
+        return p;
+    }
+
+    // Eisel-Lemire: w != 0, q in [pow5_min, pow5_max]; false - too close to a halfway point to decide here
+    bool eisel_lemire(uint64_t w, int const q, uint64_t& bits) {
+        uint64_t const* const t = powers().pow5 + (q - powers_t::pow5_min) * 2;
+        int const lz = clz(w);
+        w <<= lz;
+        uint64_t lo;
+        uint64_t hi = mul128(w, t[0], lo);
+        if ((hi & 0x1FF) == 0x1FF) { // the low bits decide the rounding, add the next 64 bits of the power
+            uint64_t lo2;
+            uint64_t const hi2 = mul128(w, t[1], lo2);
+            lo += hi2;
+            hi += hi2 > lo;
+        }
+        if (lo == ~uint64_t(0) && (q < -27 || q > 55)) // 5^q isn't exact in 128 bits there
+            return false;
+
+        int const upper = static_cast<int>(hi >> 63);
+        uint64_t m = hi >> (upper + 64 - mantissa_bits - 3);
+        int p2 = (((152170 + 65536) * q) >> 16) + 63 + upper - lz + 1023; // floor(log2(10^q)) + 63, biased
+        if (p2 <= 0) { // subnormal, rounding can still carry it to the smallest normal
+            if (-p2 + 1 >= 64) {
+                bits = 0;
+                return true;
+            }
+            m >>= -p2 + 1;
+            m += m & 1;
+            m >>= 1;
+            bits = m | uint64_t(m < c_min ? 0 : 1) << mantissa_bits;
+            return true;
+        }
+        // exactly halfway (possible for small q only): round to even instead of up
+        if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << (upper + 64 - mantissa_bits - 3)) == hi)
+            m &= ~uint64_t(1);
+        m += m & 1;
+        m >>= 1;
+        if (m >= c_min << 1) {
+            m = c_min;
+            p2++;
+        }
+        m &= ~c_min;
+        if (p2 >= 0x7FF) {
+            p2 = 0x7FF;
+            m = 0;
+        }
+        bits = m | uint64_t(p2) << mantissa_bits;
+        return true;
+    }
+
+    // Schubfach, R. Giulietti "The Schubfach way to render doubles" (2021), as in the jdk's DoubleToDecimal
+    // except that one digit is shortest too (java always prints two: 4.9E-324 here is 5e-324)
+
+    struct decimal_t {
+        uint64_t f;
+        int e;
+    };
+
+    inline int flog10pow2(int const e) { return static_cast<int>(e * 661971961083LL >> 41); }
+    inline int flog10threeQuartersPow2(int const e) { return static_cast<int>((e * 661971961083LL - 274743187321LL) >> 41); }
+    inline int flog2pow10(int const e) { return static_cast<int>(e * 913124641741LL >> 38); }
+
+    // cp * g / 2^126 rounded to odd
+    inline uint64_t rop(uint64_t const g1, uint64_t const g0, uint64_t const cp) {
+        uint64_t y0, unused;
+        uint64_t const x1 = mul128(g0, cp, unused);
+        uint64_t const y1 = mul128(g1, cp, y0);
+        uint64_t const z = (y0 >> 1) + x1;
+        uint64_t const mask = ~uint64_t(0) >> 1;
+        return (y1 + (z >> 63)) | ((z & mask) + mask) >> 63;
+    }
+
+    // |v| = c 2^q
+    decimal_t to_decimal(int const q, uint64_t const c, int const dk) {
+        uint64_t const out = c & 1;
+        uint64_t const cb = c << 2;
+        uint64_t const cbr = cb + 2;
+        uint64_t cbl;
+        int k;
+        if (c != c_min || q == q_min) { // regular spacing
+            cbl = cb - 2;
+            k = flog10pow2(q);
+        } else {                        // irregular spacing at a power of two
+            cbl = cb - 1;
+            k = flog10threeQuartersPow2(q);
+        }
+        int const h = q + flog2pow10(-k) + 2;
+        uint64_t const* const g = powers().g + (k - powers_t::g_min) * 2;
+
+        uint64_t const vb = rop(g[0], g[1], cb << h);
+        uint64_t const vbl = rop(g[0], g[1], cbl << h);
+        uint64_t const vbr = rop(g[0], g[1], cbr << h);
+
+        uint64_t const s = vb >> 2;
+        if (s >= 10) { // one digit less if exactly one of the neighbours in 10 10^k steps is inside the interval
+            uint64_t unused;
+            uint64_t const sp10 = 10 * mul128(s, 115292150460684698ull << 4, unused);
+            uint64_t const tp10 = sp10 + 10;
+            bool const upin = vbl + out <= sp10 << 2;
+            bool const wpin = (tp10 << 2) + out <= vbr;
+            if (upin != wpin)
+                return { upin ? sp10 : tp10, k + dk };
+        }
+
+        uint64_t const t = s + 1;
+        bool const uin = vbl + out <= s << 2;
+        bool const win = (t << 2) + out <= vbr;
+        if (uin != win)
+            return { uin ? s : t, k + dk };
+        // both inside: the closer one, even on a tie
+        auto const cmp = static_cast<int64_t>(vb - ((s + t) << 1));
+        return { cmp < 0 || (cmp == 0 && !(s & 1)) ? s : t, k + dk };
+    }
+
+    // f 10^e, f != 0
+    char* chars(uint64_t f, int e, char* out) {
+        for (; f % 10 == 0; f /= 10)
+            e++;
+        char d[20];
+        int const n = static_cast<int>(format(f, d) - d);
+        int const point = n + e; // 0.d 10^point
+        if (e >= 0 && point <= 21) {
+            memcpy(out, d, n);
+            memset(out + n, '0', e);
+            return out + point;
+        }
+        if (point > 0 && point <= 21) {
+            memcpy(out, d, point);
+            out[point] = '.';
+            memcpy(out + point + 1, d + point, n - point);
+            return out + n + 1;
+        }
+        if (point > -6 && point <= 0) {
+            out[0] = '0';
+            out[1] = '.';
+            memset(out + 2, '0', -point);
+            memcpy(out + 2 - point, d, n);
+            return out + 2 - point + n;
+        }
+        *out++ = d[0];
+        if (n > 1) {
+            *out++ = '.';
+            memcpy(out, d + 1, n - 1);
+            out += n - 1;
+        }
+        *out++ = 'e';
+        *out++ = point > 0 ? '+' : '-';
+        return format(static_cast<uint64_t>(point > 0 ? point - 1 : 1 - point), out);
+    }
+
+}
+
+std::from_chars_result json::parse_double(char const* const first, char const* const last, double& val) noexcept {
+    char const* p = first;
+    bool const negative = p != last && *p == '-';
+    p += negative;
+
+    // w 10^exp10, digits are taken 8 at a time while they last; w is only kept when it has
+    // up to 19 significant digits, longer mantissas go to from_chars
+    uint64_t w = 0;
+    char const* const digits = p;
+    for (; last - p >= 8 && eight_digits(p); p += 8)
+        w = w * 100000000 + parse_eight(p);
+    for (; p != last && is_digit(*p); p++)
+        w = w * 10 + static_cast<uint64_t>(*p - '0');
+    int64_t count = p - digits;
+    int64_t exp10 = 0;
+    if (p != last && *p == '.') {
+        char const* const frac = ++p;
+        for (; last - p >= 8 && eight_digits(p); p += 8)
+            w = w * 100000000 + parse_eight(p);
+        for (; p != last && is_digit(*p); p++)
+            w = w * 10 + static_cast<uint64_t>(*p - '0');
+        exp10 = frac - p;
+        count -= exp10;
+    }
+    if (!count) // inf, nan, errors
+        return std::from_chars(first, last, val);
+    if (count > 19) { // leading zeros don't count
+        for (char const* z = digits; z != p && (*z == '0' || *z == '.'); z++)
+            count -= *z == '0';
+        if (count > 19)
+            return std::from_chars(first, last, val);
+    }
+
+    if (p != last && (*p == 'e' || *p == 'E')) {
+        char const* e = p + 1;
+        bool const negexp = e != last && *e == '-';
+        if (e != last && (*e == '-' || *e == '+'))
+            e++;
+        if (e != last && is_digit(*e)) {
+            int64_t x = 0;
+            for (; e != last && is_digit(*e); e++)
+                if (x < 100000) // far out of range already
+                    x = x * 10 + (*e - '0');
+            exp10 += negexp ? -x : x;
+            p = e;
+        }
+    }
+
+    double d = 0;
+    if (!w) {
+    } else if (w <= uint64_t(1) << 53 && exp10 >= -22 && exp10 <= 22) { // both exact, one rounding
+        d = static_cast<double>(w);
+        d = exp10 < 0 ? d / exact_pow10[-exp10] : d * exact_pow10[exp10];
+    } else if (exp10 < powers_t::pow5_min || exp10 > powers_t::pow5_max) {
+        return { p, std::errc::result_out_of_range }; // 19 digits can't reach the range from there
+    } else {
+        uint64_t bits;
+        if (!eisel_lemire(w, static_cast<int>(exp10), bits))
+            return std::from_chars(first, last, val);
+        memcpy(&d, &bits, sizeof(d));
+        if (!bits || bits == uint64_t(0x7FF) << mantissa_bits)
+            return { p, std::errc::result_out_of_range };
+    }
+    val = negative ? -d : d;
+    return { p, std::errc() };
+}
+
+char* json::format(double const v, char* out) noexcept {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    int const bq = static_cast<int>(bits >> mantissa_bits) & 0x7FF;
+    if (bq == 0x7FF) {
+        memcpy(out, "null", 4);
+        return out + 4;
+    }
+    if (bits >> 63)
+        *out++ = '-';
+    uint64_t const t = bits & (c_min - 1);
+    if (bq) {
+        int const mq = -q_min + 1 - bq;
+        uint64_t const c = c_min | t;
+        if (mq > 0 && mq < mantissa_bits + 1 && !(c & ((uint64_t(1) << mq) - 1))) // an integer
+            return chars(c >> mq, 0, out);
+        auto const dec = to_decimal(-mq, c, 0);
+        return chars(dec.f, dec.e, out);
+    }
+    if (t) {
+        auto const dec = t < 3 ? to_decimal(q_min, 10 * t, -1) : to_decimal(q_min, t, 0);
+        return chars(dec.f, dec.e, out);
+    }
+    *out++ = '0';
+    return out;
+}
+
+char* json::format(int64_t const v, char* out) noexcept {
+    if (v < 0) {
+        *out++ = '-';
+        return format(0 - static_cast<uint64_t>(v), out);
+    }
+    return format(static_cast<uint64_t>(v), out);
+}
+
+char* json::format(uint64_t v, char* out) noexcept {
+    char buf[20];
+    char* p = buf + sizeof(buf);
+    for (; v >= 100; v /= 100) {
+        p -= 2;
+        memcpy(p, pairs + v % 100 * 2, 2);
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, pairs + v * 2, 2);
+    } else
+        *--p = static_cast<char>('0' + v);
+    size_t const n = static_cast<size_t>(buf + sizeof(buf) - p);
+    memcpy(out, p, n);
+    return out + n;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+
+// number text <-> binary without going through the c++ library
+// - parse_double: same contract and result as std::from_chars(first, last, double&) - correctly rounded,
+//   errc::result_out_of_range (value untouched) on overflow or underflow to zero;
+//   up to 19 significant digits are converted by Clinger's fast path (exact double times an exact power of ten)
+//   or by Eisel-Lemire (64x128-bit product with a power of five), longer mantissas and the rare products
+//   too close to a halfway point fall back to std::from_chars
+// - format: the shortest text that parses back to the same double (Schubfach), integers through a digit pair table;
+//   json form: exponent outside 1e-6 .. 1e21 like javascript, nan/inf have no json text and become null
+// - the power tables are built from exact big integers on first use (~10KB), not shipped as literals
+
+namespace json {
+
+    constexpr size_t number_chars = 32; // format() never writes more
+
+    std::from_chars_result parse_double(char const* const first, char const* const last, double& val) noexcept;
+
+    // exact overloads only, the returned pointer is the end of the text
+    char* format(double const v, char* out) noexcept;
+    char* format(int64_t const v, char* out) noexcept;
+    char* format(uint64_t v, char* out) noexcept;
+
+}
@@ -0,0 +1,357 @@
+#include "project.h"
+
+#include <tuple>
+
+using namespace json;
+
+struct projection_t::ctx_t {
+    doc_t& doc;
+    options_t const& opt;
+    std::vector<uint8_t> state{}; // probe: per pending record, 0 - open, 1 - decided, 2 - matched
+};
+
+projection_t::projection_t(std::vector<std::string_view> const& paths) : nodes(1) {
+    texts.reserve(paths.size()); // no reallocation: short paths live inside their std::string
+    for (auto const path : paths) {
+        std::string_view const text = texts.emplace_back(path);
+        uint32_t at = 0;
+        for (auto const sc : su::split(text, '/')) {
+            auto const dog = su::split(sc, '@');
+            if (dog.empty() || dog.size() > 2)
+                break; // jpath_t::walk stops here
+            at = step(at, dog.back(), dog.size() == 2);
+        }
+        nodes[at].whole = true;
+    }
+}
+
+// trie edge for one path step, classified the way jpath_t::walk does
+uint32_t projection_t::step(uint32_t const from, std::string_view const seg, bool const at) {
+    auto const child = [this] {
+        nodes.emplace_back();
+        return static_cast<uint32_t>(nodes.size() - 1);
+    };
+    if (at) {
+        auto const rec = [&](std::vector<record_t> recs, std::optional<range_t> const range) {
+            uint32_t const next = child(), key = child(), leaf = child();
+            nodes[key].names.emplace_back(range ? range->key.name : recs.front().first, leaf);
+            nodes[leaf].whole = true;
+            nodes[from].records.push_back({ std::move(recs), range, next, key });
+            return next;
+        };
+        if (auto const r = range_t::parse(seg)) { // before '=', like jpath_t::compile
+            for (auto const& x : nodes[from].records) {
+                if (x.range && std::tie(x.range->key.name, x.range->lo, x.range->hi, x.range->lo_open, x.range->hi_open) == std::tie(r->key.name, r->lo, r->hi, r->lo_open, r->hi_open))
+                    return x.next;
+            }
+            return rec({}, r);
+        }
+        if (auto const eq = su::split(seg, '='); eq.size() == 2) {
+            for (auto const& x : nodes[from].records) {
+                if (!x.range && x.name() == eq.front() && std::get<std::string_view>(x.recs.front().second) == eq.back())
+                    return x.next;
+            }
+            return rec({ record_t(eq.front(), eq.back()) }, std::nullopt);
+        }
+        int index;
+        if (auto const [ptr, ec] = std::from_chars(seg.data(), seg.data() + seg.size(), index, 10); ec == std::errc()) {
+            for (auto const& [i, next] : nodes[from].indexes) {
+                if (i == index)
+                    return next;
+            }
+            uint32_t const next = child();
+            nodes[from].indexes.emplace_back(index, next);
+            return next;
+        }
+    }
+    for (auto const& [name, next] : nodes[from].names) {
+        if (name == seg)
+            return next;
+    }
+    uint32_t const next = child();
+    nodes[from].names.emplace_back(seg, next);
+    return next;
+}
+
+result_t projection_t::parse(std::string_view const src, options_t const& opt) const {
+    result_t res;
+    options_t o = opt;
+    o.lazy = false;
+    auto& doc = res.doc;
+    doc.arena = make_arena(std::max<size_t>(src.size() / 16, 4096), o.upstream);
+    ctx_t c{ doc, o };
+
+    reader_t rd{ src };
+    node_ptr<value_t> root;
+    if (doc_t::check_utf8(rd, o)) {
+        doc_t::parse_ws(rd);
+        if (rd.has('{') || rd.has('['))
+            root = value(c, rd, { 0 });
+        else if (auto [ok, v] = doc.parse_value(rd, o); ok)
+            root = std::move(v);
+        else
+            doc_t::makeError(errc_t::value, "value expected", rd);
+        doc_t::parse_ws(rd);
+        if (!rd.done())
+            doc_t::makeError(errc_t::trailing, "unexpected characters after the root value", rd);
+    }
+
+    if (rd.failed()) {
+        root.release(); // arena memory, dropped with the arena
+        res.doc = doc_t();
+        res.error = rd.error();
+    } else {
+        doc.root = std::move(root);
+    }
+    return res;
+}
+
+// the value at rd: nullptr when no path goes on from it (skipped)
+node_ptr<value_t> projection_t::value(ctx_t& c, reader_t& rd, ids_t const& ids) const {
+    for (auto const id : ids) {
+        if (nodes[id].whole) {
+            auto [ok, v] = c.doc.parse_value(rd, c.opt);
+            if (!ok)
+                doc_t::makeError(errc_t::value, "value expected", rd);
+            return std::move(v);
+        }
+    }
+    if (rd.has('{'))
+        return object(c, rd, ids);
+    if (rd.has('['))
+        return array(c, rd, ids);
+    skip(rd); // a scalar ends every path through it
+    return nullptr;
+}
+
+node_ptr<value_t> projection_t::object(ctx_t& c, reader_t& rd, ids_t const& ids) const {
+    auto* const mr = c.doc.arena.get();
+    auto obj = make_node<object_t>(mr, mr);
+    std::vector<std::string_view> taken; // the first member of a name wins, like object_t::operator ()
+    rd.read();
+    doc_t::parse_ws(rd);
+    while (!rd.failed() && !rd.skip('}')) {
+        auto [hasName, name, escaped] = doc_t::parse_string(rd);
+        if (!hasName) {
+            doc_t::makeError(errc_t::string, "parseMember: name expected", rd);
+            break;
+        }
+        doc_t::parse_ws(rd);
+        if (!rd.skip(':')) {
+            doc_t::makeError(errc_t::colon, "parseMember: ':' expected", rd);
+            break;
+        }
+        doc_t::parse_ws(rd);
+
+        std::string_view const key = name.substr(1, name.size() - 2);
+        ids_t next;
+        if (std::find(taken.begin(), taken.end(), key) == taken.end()) {
+            for (auto const id : ids) {
+                for (auto const& [n, child] : nodes[id].names) {
+                    if (n == key)
+                        next.push_back(child);
+                }
+            }
+        }
+        if (next.empty()) {
+            skip(rd);
+        } else {
+            taken.push_back(key);
+            if (auto v = value(c, rd, next))
+                obj->add(pair_t(c.doc.intern(name, c.opt.local), std::move(v)));
+        }
+
+        doc_t::parse_ws(rd);
+        if (!rd.skip(',')) {
+            if (!rd.skip('}'))
+                doc_t::makeError(errc_t::bracket, "parseObject: '}' expected", rd);
+            break;
+        }
+        doc_t::parse_ws(rd);
+    }
+    return make_node<value_t>(mr, std::move(obj));
+}
+
+node_ptr<value_t> projection_t::array(ctx_t& c, reader_t& rd, ids_t const& ids) const {
+    auto* const mr = c.doc.arena.get();
+    auto arr = make_node<array_t>(mr, mr);
+    bool first = false; // a name step still waits for the first object element
+    bool indexes = false;
+    std::vector<rec_t const*> pending; // record steps not matched yet
+    for (auto const id : ids) {
+        first |= !nodes[id].names.empty();
+        indexes |= !nodes[id].indexes.empty();
+        for (auto const& r : nodes[id].records)
+            pending.push_back(&r);
+    }
+    size_t const open = rd.position();
+    rd.read();
+    doc_t::parse_ws(rd);
+
+    // index steps need the element count (negative ones) and exact positions: structural split first
+    std::vector<std::pair<size_t, size_t>> items;
+    size_t end = 0;
+    if (indexes && doc_t::split(rd, ']', items, end)) { // malformed: the sequential scan reports it
+        size_t const count = items.size();
+        std::vector<std::pair<size_t, uint32_t>> wanted;
+        size_t front = 0, tail = count; // [0, front) and [tail, count) keep their positions
+        for (auto const id : ids) {
+            for (auto const& [i, next] : nodes[id].indexes) {
+                if (i >= 0 && size_t(i) < count) {
+                    wanted.emplace_back(i, next);
+                    front = std::max(front, size_t(i) + 1);
+                } else if (i < 0 && size_t(-int64_t(i)) <= count) {
+                    wanted.emplace_back(count + i, next);
+                    tail = std::min(tail, count + i);
+                }
+            }
+        }
+        std::sort(wanted.begin(), wanted.end());
+
+        auto w = wanted.begin();
+        for (size_t i = 0; i < count && !rd.failed(); i++) {
+            rd.set_position(items[i].first);
+            ids_t next;
+            for (; w != wanted.end() && w->first == i; ++w)
+                next.push_back(w->second);
+            node_ptr<value_t> v;
+            if (!next.empty() || (rd.has('{') && (first || !pending.empty()))) {
+                v = element(c, rd, ids, next, first, pending);
+                doc_t::parse_ws(rd);
+                if (!rd.failed() && rd.position() != items[i].second)
+                    doc_t::makeError(errc_t::bracket, "parseArray: ']' expected", rd);
+            }
+            if (v)
+                arr->add(std::move(v));
+            else if (i < front || i >= tail)
+                arr->add(make_node<value_t>(mr, value_t::type_t::null, std::string_view("null")));
+        }
+        if (!rd.failed()) {
+            rd.set_position(end);
+            rd.read();
+        }
+        return make_node<value_t>(mr, std::move(arr));
+    }
+
+    while (!rd.failed() && !rd.skip(']')) {
+        if (!first && pending.empty() && !indexes) { // nothing left to find, bracket-match the rest
+            rd.set_position(open);
+            skip(rd);
+            break;
+        }
+        ids_t next;
+        if (auto v = element(c, rd, ids, next, first, pending))
+            arr->add(std::move(v));
+
+        doc_t::parse_ws(rd);
+        if (!rd.skip(',')) {
+            if (!rd.skip(']'))
+                doc_t::makeError(errc_t::bracket, "parseArray: ']' expected", rd);
+            break;
+        }
+        doc_t::parse_ws(rd);
+    }
+    return make_node<value_t>(mr, std::move(arr));
+}
+
+// one array element, next holds the index steps that reach it
+node_ptr<value_t> projection_t::element(ctx_t& c, reader_t& rd, ids_t const& ids, ids_t& next, bool& first, std::vector<rec_t const*>& pending) const {
+    if (rd.has('{')) {
+        if (first) { // name steps look into the first object element only, like value_t::_find
+            next.insert(next.end(), ids.begin(), ids.end());
+            first = false;
+        }
+        if (!pending.empty()) {
+            size_t const start = rd.position();
+            if (!probe(c, rd, pending, next) || next.empty())
+                return nullptr;
+            rd.set_position(start);
+        }
+    }
+    if (next.empty()) {
+        skip(rd);
+        return nullptr;
+    }
+    return value(c, rd, next);
+}
+
+// scans the object at rd without building it, the records it matches move from pending to next
+// (the first member of a key decides, like object_t::has)
+bool projection_t::probe(ctx_t& c, reader_t& rd, std::vector<rec_t const*>& pending, ids_t& next) const {
+    auto& state = c.state;
+    state.assign(pending.size(), 0);
+    rd.read();
+    doc_t::parse_ws(rd);
+    while (!rd.failed() && !rd.skip('}')) {
+        auto [hasName, name, escaped] = doc_t::parse_string(rd);
+        if (!hasName) {
+            doc_t::makeError(errc_t::string, "parseMember: name expected", rd);
+            break;
+        }
+        doc_t::parse_ws(rd);
+        if (!rd.skip(':')) {
+            doc_t::makeError(errc_t::colon, "parseMember: ':' expected", rd);
+            break;
+        }
+        doc_t::parse_ws(rd);
+
+        std::string_view const key = name.substr(1, name.size() - 2);
+        bool wanted = false;
+        for (size_t i = 0; i < pending.size(); i++)
+            wanted |= !state[i] && pending[i]->name() == key;
+        // decides every open record of this key: 2 if f(record) holds
+        auto const decide = [&](auto const f) {
+            for (size_t i = 0; i < pending.size(); i++) {
+                if (!state[i] && pending[i]->name() == key)
+                    state[i] = f(*pending[i]) ? 2 : 1;
+            }
+        };
+        if (!wanted) {
+            skip(rd);
+        } else if (rd.has('\"')) {
+            auto [hasString, source, esc] = doc_t::parse_string(rd);
+            std::string_view const str = source.size() < 2 ? std::string_view() : source.substr(1, source.size() - 2);
+            decide([str](rec_t const& rec) { return !rec.range && std::get<std::string_view>(rec.recs.front().second) == str; });
+        } else if (auto const [hasNumber, source] = doc_t::parse_number(rd); hasNumber) {
+            double d = 0;
+            parse_double(source.data(), source.data() + source.size(), d);
+            decide([d](rec_t const& rec) { return rec.range && rec.range->has(d); });
+        } else {
+            decide([](rec_t const&) { return false; }); // neither a string nor a number
+            skip(rd);
+        }
+
+        doc_t::parse_ws(rd);
+        if (!rd.skip(',')) {
+            if (!rd.skip('}'))
+                doc_t::makeError(errc_t::bracket, "parseObject: '}' expected", rd);
+            break;
+        }
+        doc_t::parse_ws(rd);
+    }
+    if (rd.failed())
+        return false;
+    for (size_t i = pending.size(); i-- > 0; ) {
+        if (state[i] == 2) {
+            next.push_back(pending[i]->next);
+            next.push_back(pending[i]->key);
+            pending.erase(pending.begin() + i);
+        }
+    }
+    return true;
+}
+
+void projection_t::skip(reader_t& rd) {
+    if (rd.has('[') || rd.has('{')) {
+        if (size_t const end = simd::match(rd.get_base_ptr(), rd.position(), rd.size(), [](size_t const) {}); end) {
+            rd.set_position(end);
+            return;
+        }
+        rd.set_position(rd.size());
+        doc_t::makeError(errc_t::bracket, "unbalanced brackets", rd);
+        return;
+    }
+    if (std::get<0>(doc_t::parse_string(rd)) || doc_t::parse_null(rd).first || doc_t::parse_bool(rd).first || doc_t::parse_number(rd).first)
+        return;
+    doc_t::makeError(errc_t::value, "value expected", rd);
+}
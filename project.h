@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+// path-projected parse: only the subtrees a fixed set of jpaths can reach are built
+// - paths use the jpath_t::find syntax (a/b, @name, @3, @-1, @key=value, @key>=1<=5) and are compiled once into a trie,
+//   parse() is const, one projection serves any number of documents and threads
+// - find() with any of the paths returns what it returns on the fully parsed doc, nothing else is kept
+// - skipped values allocate nothing and are only checked for balanced brackets/strings (simd::match)
+// - array elements skipped in front of an index step (or behind a negative one) become null to keep positions
+
+namespace json {
+
+    class projection_t {
+    public:
+        explicit projection_t(std::vector<std::string_view> const& paths);
+
+        result_t parse(std::string_view const src, options_t const& opt = options_t{}) const;
+
+    private:
+        using ids_t = std::vector<uint32_t>; // trie nodes a value is reached by
+
+        struct rec_t {
+            std::vector<record_t> recs; // single @key=value, as jpath_t::walk passes it to object_t::has
+            std::optional<range_t> range; // @key>=1<=5 instead, recs is empty then
+            uint32_t next;
+            uint32_t key; // keeps the key member in the matched element, find() looks at it
+
+            std::string_view name() const { return range ? range->key.name : recs.front().first; }
+        };
+
+        struct node_t {
+            bool whole{ false }; // a path ends here
+            std::vector<std::pair<std::string_view, uint32_t>> names; // member, or member of the first object element
+            std::vector<std::pair<int, uint32_t>> indexes;            // array element, < 0 from the end
+            std::vector<rec_t> records;                                // first object element with key == value (or in range)
+        };
+
+        struct ctx_t;
+
+        uint32_t step(uint32_t const from, std::string_view const seg, bool const at);
+
+        node_ptr<value_t> value(ctx_t& c, reader_t& rd, ids_t const& ids) const;
+        node_ptr<value_t> object(ctx_t& c, reader_t& rd, ids_t const& ids) const;
+        node_ptr<value_t> array(ctx_t& c, reader_t& rd, ids_t const& ids) const;
+        node_ptr<value_t> element(ctx_t& c, reader_t& rd, ids_t const& ids, ids_t& next, bool& first, std::vector<rec_t const*>& pending) const;
+        bool probe(ctx_t& c, reader_t& rd, std::vector<rec_t const*>& pending, ids_t& next) const;
+        static void skip(reader_t& rd);
+
+    private:
+        std::vector<std::string> texts; // owned copies of the paths, the trie points into them
+        std::vector<node_t> nodes;      // [0] - root
+    };
+
+}
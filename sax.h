@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "json.h"
+
+// event-driven parse, no tree is built: the handler sees every token as it is scanned
+// - visit() is templated on the handler so the callbacks inline, tokens are validated by the doc_t primitives
+// - strings/keys come without quotes and still escaped (see unescape), numbers come raw + decoded
+// - same grammar as doc_t::parse, a trailing comma before ']' or '}' included
+// - every callback returns action_t: stop ends the parse (visit() returns no error),
+//   skip from on_object_begin/on_array_begin/on_key jumps over that container/member value by
+//   structure only (simd::match), its end callback is not called
+
+namespace json {
+
+    enum class action_t : uint8_t { next, skip, stop };
+
+    // no-op defaults, derive and hide the events of interest
+    struct handler_t {
+        action_t on_null() { return action_t::next; }
+        action_t on_bool(bool const) { return action_t::next; }
+        action_t on_number(std::string_view const, number_t const&) { return action_t::next; }
+        action_t on_string(std::string_view const, bool const) { return action_t::next; }
+        action_t on_key(std::string_view const, bool const) { return action_t::next; }
+        action_t on_object_begin() { return action_t::next; }
+        action_t on_object_end() { return action_t::next; }
+        action_t on_array_begin() { return action_t::next; }
+        action_t on_array_end() { return action_t::next; }
+    };
+
+    class sax_t {
+    public:
+        template <typename H> static parse_error_t visit(std::string_view const src, H& h);
+
+    private:
+        // false: stopped or failed (rd.failed())
+        template <typename H> static bool parse_value(reader_t& rd, H& h);
+        template <typename H> static bool parse_array(reader_t& rd, H& h);
+        template <typename H> static bool parse_object(reader_t& rd, H& h);
+        static bool skip_value(reader_t& rd);
+
+        static std::string_view unquote(std::string_view const s) { return s.substr(1, s.size() - 2); }
+    };
+
+    template <typename H> parse_error_t sax_t::visit(std::string_view const src, H& h) {
+        reader_t rd{ src };
+        doc_t::parse_ws(rd);
+        bool const more = parse_value(rd, h);
+        if (!more || rd.failed())
+            return rd.error(); // stopped: no error
+        doc_t::parse_ws(rd);
+        if (!rd.done())
+            doc_t::makeError(errc_t::trailing, "unexpected characters after the root value", rd);
+        return rd.error();
+    }
+
+    template <typename H> bool sax_t::parse_value(reader_t& rd, H& h) {
+        switch (rd.get()) {
+        case '{':
+            return parse_object(rd, h);
+        case '[':
+            return parse_array(rd, h);
+        case '\"': {
+            auto [hasString, source, escaped] = doc_t::parse_string(rd);
+            return !rd.failed() && h.on_string(unquote(source), escaped) != action_t::stop;
+        }
+        case 'n':
+            if (auto [hasNull, source] = doc_t::parse_null(rd); hasNull)
+                return h.on_null() != action_t::stop;
+            break;
+        case 't': case 'f':
+            if (auto [hasBool, source] = doc_t::parse_bool(rd); hasBool)
+                return h.on_bool(source.front() == 't') != action_t::stop;
+            break;
+        default: {
+            number_t num;
+            if (auto [hasNumber, source] = doc_t::parse_number(rd, &num); hasNumber)
+                return !rd.failed() && h.on_number(source, num) != action_t::stop;
+        }
+        }
+        doc_t::makeError(errc_t::value, "value expected", rd);
+        return false;
+    }
+
+    template <typename H> bool sax_t::parse_array(reader_t& rd, H& h) {
+        switch (h.on_array_begin()) {
+        case action_t::stop: return false;
+        case action_t::skip: return skip_value(rd);
+        default: break;
+        }
+        rd.read();
+        doc_t::parse_ws(rd);
+        if (!rd.skip(']')) {
+            while (true) {
+                if (!parse_value(rd, h))
+                    return false;
+                doc_t::parse_ws(rd);
+                if (rd.skip(']'))
+                    break;
+                if (!rd.skip(',')) {
+                    doc_t::makeError(errc_t::bracket, "parseArray: ']' expected", rd);
+                    return false;
+                }
+                doc_t::parse_ws(rd);
+                if (rd.skip(']')) // trailing comma, accepted like doc_t::parse does
+                    break;
+            }
+        }
+        return h.on_array_end() != action_t::stop;
+    }
+
+    template <typename H> bool sax_t::parse_object(reader_t& rd, H& h) {
+        switch (h.on_object_begin()) {
+        case action_t::stop: return false;
+        case action_t::skip: return skip_value(rd);
+        default: break;
+        }
+        rd.read();
+        doc_t::parse_ws(rd);
+        if (!rd.skip('}')) {
+            while (true) {
+                auto [hasName, name, escaped] = doc_t::parse_string(rd);
+                if (!hasName)
+                    doc_t::makeError(errc_t::string, "parseMember: name expected", rd);
+                doc_t::parse_ws(rd);
+                if (!rd.skip(':'))
+                    doc_t::makeError(errc_t::colon, "parseMember: ':' expected", rd);
+                doc_t::parse_ws(rd);
+                if (rd.failed())
+                    return false;
+                auto const act = h.on_key(unquote(name), escaped);
+                if (act == action_t::stop || !(act == action_t::skip ? skip_value(rd) : parse_value(rd, h)))
+                    return false;
+                doc_t::parse_ws(rd);
+                if (rd.skip('}'))
+                    break;
+                if (!rd.skip(',')) {
+                    doc_t::makeError(errc_t::bracket, "parseObject: '}' expected", rd);
+                    return false;
+                }
+                doc_t::parse_ws(rd);
+                if (rd.skip('}')) // trailing comma
+                    break;
+            }
+        }
+        return h.on_object_end() != action_t::stop;
+    }
+
+    inline bool sax_t::skip_value(reader_t& rd) {
+        if (rd.has('[') || rd.has('{')) {
+            if (size_t const end = simd::match(rd.get_base_ptr(), rd.position(), rd.size(), [](size_t const) {}); end) {
+                rd.set_position(end);
+                return true;
+            }
+            rd.set_position(rd.size());
+            doc_t::makeError(errc_t::bracket, "unbalanced brackets", rd);
+            return false;
+        }
+        handler_t none; // scalars are cheap, validate them
+        return parse_value(rd, none);
+    }
+
+}
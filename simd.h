@@ -0,0 +1,456 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JSON_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JSON_SIMD_SSE2 1
+#endif
+
+// structural scanner: classifies 64-byte blocks into bit masks (bit i == byte i of the block)
+// - block loads are always 64-byte aligned, an aligned block never crosses a page boundary,
+//   so the partial head/tail blocks of a buffer can be loaded safely and masked afterwards
+// - AVX2 = 2x32 bytes, SSE2 = 4x16 bytes, scalar fallback = byte loop
+
+// the partial block reads are intentional, keep address sanitizer quiet about them
+#if defined(__GNUC__) || defined(__clang__)
+#define JSON_SIMD_NO_ASAN __attribute__((no_sanitize_address))
+#elif defined(_MSC_VER)
+#define JSON_SIMD_NO_ASAN __declspec(no_sanitize_address)
+#else
+#define JSON_SIMD_NO_ASAN
+#endif
+
+namespace json::simd {
+
+    constexpr size_t block_size = 64;
+
+    inline unsigned ctz(uint64_t const m) noexcept { // m != 0
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long idx;
+        _BitScanForward64(&idx, m);
+        return static_cast<unsigned>(idx);
+#elif defined(_MSC_VER)
+        unsigned long idx;
+        if (_BitScanForward(&idx, static_cast<uint32_t>(m)))
+            return static_cast<unsigned>(idx);
+        _BitScanForward(&idx, static_cast<uint32_t>(m >> 32));
+        return static_cast<unsigned>(idx) + 32;
+#else
+        return static_cast<unsigned>(__builtin_ctzll(m));
+#endif
+    }
+
+    // __popcnt64 is x64 only and needs the POPCNT instruction, implied by /arch:AVX2
+    inline unsigned popcount(uint64_t m) noexcept {
+#if defined(_MSC_VER) && defined(_M_X64) && defined(__AVX2__)
+        return static_cast<unsigned>(__popcnt64(m));
+#elif defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_popcountll(m));
+#else
+        m -= (m >> 1) & 0x5555555555555555ull;
+        m = (m & 0x3333333333333333ull) + ((m >> 2) & 0x3333333333333333ull);
+        m = (m + (m >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return static_cast<unsigned>((m * 0x0101010101010101ull) >> 56);
+#endif
+    }
+
+    // bits of the chars escaped by a backslash run, carry: the first char of the next block is escaped
+    inline uint64_t escaped(uint64_t const bs, uint64_t& carry) noexcept {
+        constexpr uint64_t odd = 0xAAAAAAAAAAAAAAAAull;
+        if (!bs) {
+            uint64_t const e = carry;
+            carry = 0;
+            return e;
+        }
+        uint64_t const potential = bs & ~carry;
+        uint64_t const code = (((potential << 1) | odd) - potential) ^ odd; // run starts on even/odd bits
+        uint64_t const e = code ^ (bs | carry);
+        carry = (code & bs) >> 63;
+        return e;
+    }
+
+    // bit i = xor of bits [0, i]: quote bits -> inside-string bits
+    inline uint64_t prefix_xor(uint64_t m) noexcept {
+        m ^= m << 1;
+        m ^= m << 2;
+        m ^= m << 4;
+        m ^= m << 8;
+        m ^= m << 16;
+        m ^= m << 32;
+        return m;
+    }
+
+#if defined(JSON_SIMD_AVX2)
+    using reg_t = __m256i;
+    constexpr size_t reg_size = 32;
+    JSON_SIMD_NO_ASAN inline reg_t load(char const* p) noexcept { return _mm256_load_si256(reinterpret_cast<reg_t const*>(p)); }
+    inline reg_t splat(char const ch) noexcept { return _mm256_set1_epi8(ch); }
+    inline reg_t eq(reg_t const a, reg_t const b) noexcept { return _mm256_cmpeq_epi8(a, b); }
+    inline reg_t bor(reg_t const a, reg_t const b) noexcept { return _mm256_or_si256(a, b); }
+    inline reg_t le_u8(reg_t const a, reg_t const b) noexcept { return _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a); }
+    inline reg_t sub(reg_t const a, reg_t const b) noexcept { return _mm256_sub_epi8(a, b); }
+    inline uint64_t movemask(reg_t const a) noexcept { return static_cast<uint32_t>(_mm256_movemask_epi8(a)); }
+#elif defined(JSON_SIMD_SSE2)
+    using reg_t = __m128i;
+    constexpr size_t reg_size = 16;
+    JSON_SIMD_NO_ASAN inline reg_t load(char const* p) noexcept { return _mm_load_si128(reinterpret_cast<reg_t const*>(p)); }
+    inline reg_t splat(char const ch) noexcept { return _mm_set1_epi8(ch); }
+    inline reg_t eq(reg_t const a, reg_t const b) noexcept { return _mm_cmpeq_epi8(a, b); }
+    inline reg_t bor(reg_t const a, reg_t const b) noexcept { return _mm_or_si128(a, b); }
+    inline reg_t le_u8(reg_t const a, reg_t const b) noexcept { return _mm_cmpeq_epi8(_mm_min_epu8(a, b), a); }
+    inline reg_t sub(reg_t const a, reg_t const b) noexcept { return _mm_sub_epi8(a, b); }
+    inline uint64_t movemask(reg_t const a) noexcept { return static_cast<uint16_t>(_mm_movemask_epi8(a)); }
+#endif
+
+#if defined(JSON_SIMD_AVX2) || defined(JSON_SIMD_SSE2)
+    class block_t {
+        static constexpr size_t count = block_size / reg_size;
+
+    public:
+        JSON_SIMD_NO_ASAN explicit block_t(char const* p) noexcept { for (size_t i = 0; i < count; i++) r[i] = load(p + i * reg_size); }
+
+        uint64_t eq(char const ch) const noexcept {
+            reg_t const c = splat(ch);
+            return collect([c](reg_t const v) { return simd::eq(v, c); });
+        }
+
+        uint64_t quote() const noexcept { return eq('\"'); }
+        uint64_t backslash() const noexcept { return eq('\\'); }
+
+        uint64_t ws() const noexcept {
+            reg_t const sp = splat(' '), tab = splat('\t'), cr = splat('\r'), lf = splat('\n');
+            return collect([=](reg_t const v) { return bor(bor(simd::eq(v, sp), simd::eq(v, tab)), bor(simd::eq(v, cr), simd::eq(v, lf))); });
+        }
+
+        uint64_t structural() const noexcept {
+            reg_t const lb = splat('['), rb = splat(']'), lc = splat('{'), rc = splat('}'), colon = splat(':'), comma = splat(',');
+            return collect([=](reg_t const v) {
+                return bor(bor(bor(simd::eq(v, lb), simd::eq(v, rb)), bor(simd::eq(v, lc), simd::eq(v, rc))), bor(simd::eq(v, colon), simd::eq(v, comma)));
+            });
+        }
+
+        uint64_t escape() const noexcept { // what json::escape rewrites: '"', '\\' and control chars
+            reg_t const q = splat('\"'), bs = splat('\\'), ctl = splat(0x1F);
+            return collect([=](reg_t const v) { return bor(bor(simd::eq(v, q), simd::eq(v, bs)), le_u8(v, ctl)); });
+        }
+
+        uint64_t digit() const noexcept {
+            reg_t const zero = splat('0'), nine = splat(9);
+            return collect([=](reg_t const v) { return le_u8(sub(v, zero), nine); });
+        }
+
+    private:
+        template <typename F> uint64_t collect(F f) const noexcept {
+            uint64_t m = 0;
+            for (size_t i = 0; i < count; i++)
+                m |= movemask(f(r[i])) << (i * reg_size);
+            return m;
+        }
+
+    private:
+        reg_t r[count];
+    };
+
+    // position of the first byte in [pos, size) selected by mask(block), or size
+    template <typename M> JSON_SIMD_NO_ASAN size_t find(char const* const data, size_t const pos, size_t const size, M mask) noexcept {
+        if (pos >= size)
+            return size;
+        char const* const end = data + size;
+        char const* const p = data + pos;
+        char const* blk = reinterpret_cast<char const*>(reinterpret_cast<uintptr_t>(p) & ~(block_size - 1));
+        uint64_t m = mask(block_t(blk)) & (~0ull << (p - blk));
+        while (!m) {
+            blk += block_size;
+            if (blk >= end)
+                return size;
+            m = mask(block_t(blk));
+        }
+        size_t const r = static_cast<size_t>(blk - data) + ctz(m);
+        return r < size ? r : size;
+    }
+
+    // number of ch bytes in [pos, size)
+    JSON_SIMD_NO_ASAN inline size_t count(char const* const data, size_t const pos, size_t const size, char const ch) noexcept {
+        if (pos >= size)
+            return 0;
+        char const* const end = data + size;
+        char const* const p = data + pos;
+        char const* blk = reinterpret_cast<char const*>(reinterpret_cast<uintptr_t>(p) & ~(block_size - 1));
+        uint64_t m = block_t(blk).eq(ch) & (~0ull << (p - blk));
+        size_t n = 0;
+        while (blk + block_size < end) {
+            n += popcount(m);
+            blk += block_size;
+            m = block_t(blk).eq(ch);
+        }
+        size_t const tail = static_cast<size_t>(end - blk);
+        return n + popcount(tail < block_size ? m & ((1ull << tail) - 1) : m);
+    }
+
+    inline size_t skip_ws(char const* data, size_t pos, size_t size) noexcept {
+        return find(data, pos, size, [](block_t const& b) { return ~b.ws(); });
+    }
+
+    inline size_t skip_digits(char const* data, size_t pos, size_t size) noexcept {
+        return find(data, pos, size, [](block_t const& b) { return ~b.digit(); });
+    }
+
+    inline size_t find_quote_or_backslash(char const* data, size_t pos, size_t size) noexcept {
+        return find(data, pos, size, [](block_t const& b) { return b.quote() | b.backslash(); });
+    }
+
+    inline size_t find_escape(char const* data, size_t pos, size_t size) noexcept {
+        return find(data, pos, size, [](block_t const& b) { return b.escape(); });
+    }
+
+    inline size_t find_structural(char const* data, size_t pos, size_t size) noexcept {
+        return find(data, pos, size, [](block_t const& b) { return b.structural() | b.quote(); });
+    }
+
+    inline size_t find_char(char const* data, size_t pos, size_t size, char const ch) noexcept {
+        return find(data, pos, size, [ch](block_t const& b) { return b.eq(ch); });
+    }
+
+    // position after the bracket closing the one at data[pos], 0 if unbalanced
+    // on_comma(ofs) gets the ',' of the container's own level, strings are skipped as a whole:
+    // escapes and quotes become in-string masks, blocks that cannot get back to that level are only counted
+    template <typename F> JSON_SIMD_NO_ASAN size_t match(char const* const data, size_t const pos, size_t const size, F on_comma) noexcept {
+        char const* const end = data + size;
+        char const* blk = reinterpret_cast<char const*>(reinterpret_cast<uintptr_t>(data + pos) & ~(block_size - 1));
+        uint64_t valid = ~0ull << (data + pos - blk);
+        uint64_t carry = 0, instr = 0;
+        size_t depth = 0;
+        for (; blk < end; blk += block_size, valid = ~0ull) {
+            if (end - blk < static_cast<ptrdiff_t>(block_size))
+                valid &= (1ull << (end - blk)) - 1;
+            block_t const b(blk);
+            uint64_t const quote = b.quote() & valid & ~escaped(b.backslash() & valid, carry);
+            uint64_t const in = prefix_xor(quote) ^ instr;
+            instr = static_cast<uint64_t>(static_cast<int64_t>(in) >> 63);
+            uint64_t const outside = ~in & valid;
+            uint64_t const open = (b.eq('[') | b.eq('{')) & outside;
+            uint64_t const close = (b.eq(']') | b.eq('}')) & outside;
+            size_t const closes = popcount(close);
+            if (depth > closes + 1) { // stays nested below the container's level
+                depth += popcount(open) - closes;
+                continue;
+            }
+            uint64_t const comma = b.eq(',') & outside;
+            for (uint64_t m = open | close | comma; m; m &= m - 1) {
+                unsigned const i = ctz(m);
+                uint64_t const bit = 1ull << i;
+                if (open & bit)
+                    depth++;
+                else if (close & bit) {
+                    if (--depth == 0)
+                        return static_cast<size_t>(blk - data) + i + 1;
+                } else if (depth == 1)
+                    on_comma(static_cast<size_t>(blk - data) + i);
+            }
+        }
+        return 0;
+    }
+#else
+    inline size_t count(char const* data, size_t pos, size_t const size, char const ch) noexcept {
+        size_t n = 0;
+        for (; pos < size; pos++)
+            n += data[pos] == ch;
+        return n;
+    }
+
+    inline size_t skip_ws(char const* data, size_t pos, size_t size) noexcept {
+        for (; pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\r' || data[pos] == '\n'); pos++);
+        return pos;
+    }
+
+    inline size_t skip_digits(char const* data, size_t pos, size_t size) noexcept {
+        for (; pos < size && data[pos] >= '0' && data[pos] <= '9'; pos++);
+        return pos;
+    }
+
+    inline size_t find_quote_or_backslash(char const* data, size_t pos, size_t size) noexcept {
+        for (; pos < size && data[pos] != '\"' && data[pos] != '\\'; pos++);
+        return pos;
+    }
+
+    inline size_t find_escape(char const* data, size_t pos, size_t size) noexcept {
+        for (; pos < size && data[pos] != '\"' && data[pos] != '\\' && static_cast<unsigned char>(data[pos]) >= 0x20; pos++);
+        return pos;
+    }
+
+    inline size_t find_structural(char const* data, size_t pos, size_t size) noexcept {
+        for (; pos < size; pos++) {
+            switch (data[pos]) {
+            case '[': case ']': case '{': case '}': case ':': case ',': case '\"': return pos;
+            }
+        }
+        return pos;
+    }
+
+    inline size_t find_char(char const* data, size_t pos, size_t size, char const ch) noexcept {
+        for (; pos < size && data[pos] != ch; pos++);
+        return pos;
+    }
+
+    template <typename F> size_t match(char const* data, size_t pos, size_t const size, F on_comma) noexcept {
+        size_t depth = 0;
+        for (bool str = false, esc = false; pos < size; pos++) {
+            char const ch = data[pos];
+            if (str) {
+                if (esc) esc = false;
+                else if (ch == '\\') esc = true;
+                else if (ch == '\"') str = false;
+                continue;
+            }
+            switch (ch) {
+            case '\"': str = true; break;
+            case '[': case '{': depth++; break;
+            case ']': case '}': if (--depth == 0) return pos + 1; break;
+            case ',': if (depth == 1) on_comma(pos); break;
+            }
+        }
+        return 0;
+    }
+#endif
+
+
+    // utf-8: scalar decoder for the head/tail and for pinning down the offset once a vector check failed
+    // advances pos over whole sequences until pos >= end, false: pos is at the first invalid one
+    inline bool utf8_step(unsigned char const* s, size_t& pos, size_t const end, size_t const size) noexcept {
+        while (pos < end) {
+            unsigned const c = s[pos];
+            if (c < 0x80) {
+                pos++;
+                continue;
+            }
+            // lead -> length and the allowed range of the 2nd byte (rules out overlong, surrogates, > U+10FFFF)
+            size_t const n = c >= 0xC2 && c <= 0xDF ? 2 : c >= 0xE0 && c <= 0xEF ? 3 : c >= 0xF0 && c <= 0xF4 ? 4 : 0;
+            if (!n || pos + n > size)
+                return false; // stray continuation, C0/C1/F5..FF, cut at the end
+            unsigned const lo = c == 0xE0 ? 0xA0 : c == 0xF0 ? 0x90 : 0x80;
+            unsigned const hi = c == 0xED ? 0x9F : c == 0xF4 ? 0x8F : 0xBF;
+            if (s[pos + 1] < lo || s[pos + 1] > hi)
+                return false;
+            for (size_t k = 2; k < n; k++) {
+                if ((s[pos + k] & 0xC0) != 0x80)
+                    return false;
+            }
+            pos += n;
+        }
+        return true;
+    }
+
+    // start of the sequence that runs over byte i (its lead is among the 3 bytes before), otherwise i
+    inline size_t utf8_resume(unsigned char const* s, size_t const i) noexcept {
+        for (size_t k = 1; k <= 3 && k <= i; k++) {
+            unsigned const c = s[i - k];
+            if ((c & 0xC0) != 0x80)
+                return (c >= 0xF0 ? 4u : c >= 0xE0 ? 3u : c >= 0xC0 ? 2u : 1u) > k ? i - k : i;
+        }
+        return i;
+    }
+
+#if defined(JSON_SIMD_AVX2)
+    // lookup-table validation (Keiser & Lemire): the high/low nibbles of each byte and the high nibble of the next one
+    // index three 16-entry tables, their AND is non-zero exactly at the invalid 2-byte patterns; 3/4-byte lengths
+    // are checked from the bytes 2 and 3 positions back
+    namespace utf8 {
+        constexpr uint8_t too_short = 1 << 0, too_long = 1 << 1, overlong_3 = 1 << 2, too_large = 1 << 3,
+            surrogate = 1 << 4, overlong_2 = 1 << 5, too_large_1000 = 1 << 6, overlong_4 = 1 << 6, two_conts = 1 << 7,
+            carry = too_short | too_long | two_conts;
+
+        inline __m256i table(uint8_t const (&t)[16]) noexcept {
+            return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(t)));
+        }
+
+        inline __m256i nibble_hi(__m256i const v) noexcept { return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F)); }
+
+        // input shifted by n bytes, the first n taken from the end of prev
+        template <int N> __m256i prev(__m256i const input, __m256i const prev_input) noexcept {
+            return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+        }
+
+        inline __m256i check(__m256i const input, __m256i const prev_input) noexcept {
+            static constexpr uint8_t byte_1_high[16] = {
+                too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long, // 0xxx ascii
+                two_conts, two_conts, two_conts, two_conts,                                     // 10xx continuation
+                too_short | overlong_2,                                                         // 1100
+                too_short,                                                                      // 1101
+                too_short | overlong_3 | surrogate,                                             // 1110
+                too_short | too_large | too_large_1000 | overlong_4 };                          // 1111
+            static constexpr uint8_t byte_1_low[16] = {
+                carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry,
+                carry | too_large, carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+                carry | too_large | too_large_1000, carry | too_large | too_large_1000 | surrogate, carry | too_large | too_large_1000, carry | too_large | too_large_1000 };
+            static constexpr uint8_t byte_2_high[16] = {
+                too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+                too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4, // 1000
+                too_long | overlong_2 | two_conts | overlong_3 | too_large,                  // 1001
+                too_long | overlong_2 | two_conts | surrogate | too_large,                   // 101x
+                too_long | overlong_2 | two_conts | surrogate | too_large,
+                too_short, too_short, too_short, too_short };
+
+            __m256i const prev1 = prev<1>(input, prev_input);
+            __m256i const sc = _mm256_and_si256(_mm256_and_si256(
+                _mm256_shuffle_epi8(table(byte_1_high), nibble_hi(prev1)),
+                _mm256_shuffle_epi8(table(byte_1_low), _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+                _mm256_shuffle_epi8(table(byte_2_high), nibble_hi(input)));
+            // a byte 2 or 3 positions after a 3/4-byte lead must be a continuation: exactly there sc has two_conts set
+            __m256i const third = _mm256_subs_epu8(prev<2>(input, prev_input), _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+            __m256i const fourth = _mm256_subs_epu8(prev<3>(input, prev_input), _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+            __m256i const must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+            return _mm256_xor_si256(must23, sc);
+        }
+    }
+
+    // offset of the first byte of an invalid UTF-8 sequence, or size
+    inline size_t validate_utf8(char const* const data, size_t const size) noexcept {
+        auto const* s = reinterpret_cast<unsigned char const*>(data);
+        size_t pos = 0;
+        __m256i prev_input = _mm256_setzero_si256();
+        for (; pos + 32 <= size; pos += 32) {
+            __m256i const input = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(s + pos));
+            if (!_mm256_movemask_epi8(input)) { // ascii: only a sequence cut by the previous chunk can be wrong
+                if (utf8_resume(s, pos) != pos)
+                    break;
+            } else if (__m256i const err = utf8::check(input, prev_input); !_mm256_testz_si256(err, err))
+                break;
+            prev_input = input;
+        }
+        pos = utf8_resume(s, pos); // the scalar pass finishes the tail or finds the exact offset
+        utf8_step(s, pos, size, size);
+        return pos;
+    }
+#elif defined(JSON_SIMD_SSE2)
+    // no byte shuffle in SSE2: ascii chunks are skipped 16 bytes at a time, the rest is decoded
+    inline size_t validate_utf8(char const* const data, size_t const size) noexcept {
+        auto const* s = reinterpret_cast<unsigned char const*>(data);
+        size_t pos = 0;
+        while (pos + 16 <= size) {
+            if (!_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(s + pos))))
+                pos += 16;
+            else if (!utf8_step(s, pos, pos + 16, size))
+                return pos;
+        }
+        utf8_step(s, pos, size, size);
+        return pos;
+    }
+#else
+    inline size_t validate_utf8(char const* const data, size_t const size) noexcept {
+        size_t pos = 0;
+        utf8_step(reinterpret_cast<unsigned char const*>(data), pos, size, size);
+        return pos;
+    }
+#endif
+
+}
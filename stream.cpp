@@ -0,0 +1,250 @@
+#include "stream.h"
+
+using namespace json;
+
+namespace {
+    constexpr bool is_number_char(char const ch) noexcept { return is_digit(ch) || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E'; }
+    constexpr bool is_literal_char(char const ch) noexcept { return ch >= 'a' && ch <= 'z'; }
+}
+
+stream_t::stream_t(options_t const& o) : opt{ o } {
+    opt.local = true; // chunks are gone after feed()
+    doc.arena = make_arena(1 << 16);
+}
+
+bool stream_t::feed(std::string_view const chunk) {
+    if (err || chunk.empty())
+        return !err;
+
+    size_t pos = 0;
+    if (kind != token_t::none)
+        scan(chunk, pos, kind == token_t::string && escape ? 1 : 0);
+
+    while (!err && pos < chunk.size()) {
+        pos = simd::skip_ws(chunk.data(), pos, chunk.size());
+        if (pos == chunk.size())
+            break;
+        char const ch = chunk[pos];
+        size_t const ofs = base + pos;
+        switch (expect) {
+        case expect_t::value_or_close:
+            if (ch == ']') {
+                close(ch, ofs);
+                pos++;
+                break;
+            }
+            [[fallthrough]];
+        case expect_t::value:
+            if (ch == '[' || ch == '{') {
+                open(ch);
+                pos++;
+                break;
+            }
+            kind = ch == '\"' ? token_t::string : ch == '-' || is_digit(ch) ? token_t::number : is_literal_char(ch) ? token_t::literal : token_t::none;
+            if (kind == token_t::none) {
+                fail(errc_t::value, "value expected", ofs);
+                break;
+            }
+            start = ofs;
+            scan(chunk, pos, kind == token_t::string ? pos + 1 : pos);
+            break;
+        case expect_t::name_or_close:
+            if (ch == '}') {
+                close(ch, ofs);
+                pos++;
+                break;
+            }
+            [[fallthrough]];
+        case expect_t::name:
+            if (ch != '\"') {
+                fail(errc_t::string, "parseMember: name expected", ofs);
+                break;
+            }
+            kind = token_t::string;
+            start = ofs;
+            scan(chunk, pos, pos + 1);
+            break;
+        case expect_t::colon:
+            if (ch != ':') {
+                fail(errc_t::colon, "parseMember: ':' expected", ofs);
+                break;
+            }
+            expect = expect_t::value;
+            pos++;
+            break;
+        case expect_t::comma_or_close:
+            if (ch == ',') {
+                expect = stack.back().object ? expect_t::name_or_close : expect_t::value_or_close; // a trailing comma, like doc_t::parse
+                pos++;
+            } else if (ch == ']' || ch == '}') {
+                close(ch, ofs);
+                pos++;
+            } else {
+                fail(errc_t::bracket, stack.back().object ? "parseObject: '}' expected" : "parseArray: ']' expected", ofs);
+            }
+            break;
+        case expect_t::end:
+            fail(errc_t::trailing, "unexpected characters after the root value", ofs);
+            break;
+        }
+    }
+
+    base += chunk.size();
+    return !err;
+}
+
+result_t stream_t::finish() {
+    if (!err && kind != token_t::none) {
+        if (kind == token_t::string)
+            fail(errc_t::eof, "parseString: '\"' expected", base);
+        else
+            token(pending, true); // numbers and literals end with the input
+        pending.clear();
+    }
+    if (!err && expect != expect_t::end)
+        fail(errc_t::eof, stack.empty() ? "value expected" : stack.back().array ? "parseArray: ']' expected" : "parseObject: '}' expected", base);
+
+    stack.clear();
+    result_t res;
+    res.error = err;
+    if (!err)
+        res.doc = std::move(doc);
+    return res;
+}
+
+// scans the current token from pos (its body from `from`), false while the chunk ends inside it
+bool stream_t::scan(std::string_view const chunk, size_t& pos, size_t const from) {
+    size_t end = from;
+    bool done = false;
+    if (kind == token_t::string) {
+        escape = false;
+        while (!done && end < chunk.size()) {
+            end = simd::find_quote_or_backslash(chunk.data(), end, chunk.size());
+            if (end == chunk.size())
+                break;
+            if (chunk[end] == '\\') {
+                escape = end + 1 == chunk.size();
+                end += escape ? 1 : 2;
+            } else {
+                end++;
+                done = true;
+            }
+        }
+    } else {
+        auto const pred = kind == token_t::number ? is_number_char : is_literal_char;
+        for (; end < chunk.size() && pred(chunk[end]); end++);
+        done = end < chunk.size();
+    }
+
+    if (!done) {
+        pending.append(chunk.substr(pos));
+        pos = chunk.size();
+        return false;
+    }
+    if (pending.empty()) {
+        token(chunk.substr(pos, end - pos), false);
+    } else {
+        pending.append(chunk.substr(pos, end - pos));
+        token(pending, false);
+        pending.clear();
+    }
+    pos = end;
+    return !err;
+}
+
+// complete scalar token: validated by the doc_t primitives, then attached to the tree
+void stream_t::token(std::string_view const text, bool const last) {
+    auto* const mr = doc.arena.get();
+    bool const name = expect == expect_t::name || expect == expect_t::name_or_close;
+    token_t const k = kind;
+    kind = token_t::none;
+
+    reader_t rd{ text };
+    node_ptr<value_t> v;
+    name_t const* member = nullptr;
+    switch (k) {
+    case token_t::string:
+        if (auto [ok, source, escaped] = doc_t::parse_string(rd); ok && !rd.failed()) {
+            if (name)
+                member = doc.intern(source, true);
+            else
+                v = make_node<value_t>(mr, value_t::type_t::string, arena_str(mr, source), escaped);
+        }
+        break;
+    case token_t::number:
+        if (opt.numbers) {
+            number_t num;
+            if (auto [ok, source] = doc_t::parse_number(rd, &num); ok && !rd.failed())
+                v = make_node<value_t>(mr, arena_str(mr, source), num);
+        } else if (auto [ok, source] = doc_t::parse_number(rd); ok && !rd.failed()) {
+            v = make_node<value_t>(mr, value_t::type_t::number, arena_str(mr, source), false);
+        }
+        break;
+    case token_t::literal:
+        if (auto [ok, source] = doc_t::parse_null(rd); ok)
+            v = make_node<value_t>(mr, value_t::type_t::null, source);
+        else if (auto [ok, source] = doc_t::parse_bool(rd); ok)
+            v = make_node<value_t>(mr, value_t::type_t::boolean, source);
+        break;
+    default:
+        break;
+    }
+
+    errc_t const code = k == token_t::string ? errc_t::string : k == token_t::number ? errc_t::number : errc_t::value;
+    if (rd.failed()) {
+        // the token reader always fails at its own end, only the real end of input is eof
+        auto const& e = rd.error();
+        fail(e.code == errc_t::eof && !last ? code : e.code, e.what, start + e.offset);
+    } else if (!rd.done() || (!v && !member)) {
+        fail(code, k == token_t::number ? "malformed number" : "value expected", start + rd.position());
+    } else if (name) {
+        stack.back().name = member;
+        expect = expect_t::colon;
+    } else {
+        emit(std::move(v));
+    }
+}
+
+void stream_t::open(char const ch) {
+    auto* const mr = doc.arena.get();
+    frame_t f;
+    if (ch == '[') {
+        f.array = make_node<array_t>(mr, mr);
+        expect = expect_t::value_or_close;
+    } else {
+        f.object = make_node<object_t>(mr, mr);
+        expect = expect_t::name_or_close;
+    }
+    stack.push_back(std::move(f));
+}
+
+void stream_t::close(char const ch, size_t const ofs) {
+    auto* const mr = doc.arena.get();
+    auto& top = stack.back();
+    if ((ch == ']') != bool(top.array)) {
+        fail(errc_t::bracket, top.array ? "parseArray: ']' expected" : "parseObject: '}' expected", ofs);
+        return;
+    }
+    auto v = top.array ? make_node<value_t>(mr, std::move(top.array)) : make_node<value_t>(mr, std::move(top.object));
+    stack.pop_back();
+    emit(std::move(v));
+}
+
+void stream_t::emit(node_ptr<value_t>&& v) {
+    if (stack.empty()) {
+        doc.root = std::move(v);
+        expect = expect_t::end;
+        return;
+    }
+    auto& top = stack.back();
+    if (top.object)
+        top.object->add(pair_t(top.name, std::move(v)));
+    else
+        top.array->add(std::move(v));
+    expect = expect_t::comma_or_close;
+}
+
+void stream_t::fail(errc_t const code, char const* what, size_t const ofs) {
+    if (!err)
+        err = { code, ofs, what };
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+// incremental push parser: feed() arbitrary chunks as they arrive, finish() hands over the doc
+// - same grammar as doc_t::parse (a trailing comma before ']' or '}' included), builds the same value_t tree,
+//   every string/number is copied into the doc arena (options_t::local is implied), so a chunk can be dropped
+//   as soon as feed() returns
+// - the container stack and the grammar state live in the parser, not on the call stack
+// - only a scalar token cut by a chunk boundary is buffered, never the whole input
+
+namespace json {
+
+    class stream_t {
+    public:
+        explicit stream_t(options_t const& opt = options_t{});
+        stream_t(stream_t const&) = delete;
+
+        bool feed(std::string_view const chunk); // false once the input is known to be malformed
+        result_t finish();                        // end of input, the parser is spent afterwards
+
+        parse_error_t const& error() const noexcept { return err; }
+        size_t position() const noexcept { return base; } // bytes fed so far
+
+    private:
+        enum class expect_t : uint8_t { value, value_or_close, name, name_or_close, colon, comma_or_close, end };
+        enum class token_t : uint8_t { none, string, number, literal };
+
+        struct frame_t {
+            node_ptr<array_t> array;
+            node_ptr<object_t> object;
+            name_t const* name{ nullptr }; // pending member name
+        };
+
+        bool scan(std::string_view const chunk, size_t& pos, size_t from);
+        void token(std::string_view const text, bool const last);
+        void open(char const ch);
+        void close(char const ch, size_t const ofs);
+        void emit(node_ptr<value_t>&& v);
+        void fail(errc_t const code, char const* what, size_t const ofs);
+
+    private:
+        options_t opt;
+        doc_t doc;
+        std::vector<frame_t> stack;
+        expect_t expect{ expect_t::value };
+        token_t kind{ token_t::none };
+        bool escape{ false };     // chunk ended right after a '\\' inside a string
+        std::string pending;      // scalar token cut by a chunk boundary
+        size_t start{ 0 };        // offset of the pending token
+        size_t base{ 0 };         // offset of the current chunk
+        parse_error_t err;
+    };
+
+}
@@ -0,0 +1,95 @@
+#include "tape.h"
+#include "writer.h"
+
+using namespace json;
+
+void tape_t::parse(std::string_view const src) {
+    words.reserve(src.size() / 8);
+    chars.reserve(src.size() / 2);
+    reader_t rd{ src };
+    doc_t::parse_ws(rd);
+    if (!parse_value(rd))
+        doc_t::makeError(errc_t::value, "value expected", rd);
+    doc_t::parse_ws(rd);
+    if (!rd.done())
+        doc_t::makeError(errc_t::trailing, "unexpected characters after the root value", rd);
+    if (rd.failed()) {
+        words.clear();
+        chars.clear();
+        doc_t::throwError(rd);
+    }
+}
+
+void tape_t::push_text(char const tag, std::string_view const s) {
+    words.push_back(word(tag, chars.size()));
+    uint32_t const len = static_cast<uint32_t>(s.size());
+    chars.append(reinterpret_cast<char const*>(&len), sizeof(len));
+    chars.append(s);
+}
+
+bool tape_t::parse_value(reader_t& rd) {
+    doc_t::parse_ws(rd);
+    if (auto [hasNull, source] = doc_t::parse_null(rd); hasNull)
+        return words.push_back(word('n')), true;
+    if (auto [hasBool, source] = doc_t::parse_bool(rd); hasBool)
+        return words.push_back(word(source.front())), true;
+    if (auto [hasNumber, source] = doc_t::parse_number(rd); hasNumber)
+        return push_text('#', source), true;
+    if (auto [hasString, source, escaped] = doc_t::parse_string(rd); hasString)
+        return push_text('\"', source), true;
+    if (parse_container(rd, '[', ']'))
+        return true;
+    if (parse_container(rd, '{', '}'))
+        return true;
+    doc_t::parse_ws(rd);
+    return false;
+}
+
+bool tape_t::parse_container(reader_t& rd, char const open, char const close) {
+    doc_t::parse_ws(rd);
+    if (!rd.skip(open))
+        return false;
+    doc_t::parse_ws(rd);
+
+    size_t const start = words.size();
+    words.push_back(word(open));
+    uint64_t count = 0;
+    while (true) {
+        if (open == '{') {
+            auto [hasName, name, escaped] = doc_t::parse_string(rd);
+            if (!hasName)
+                break;
+            push_text('\"', name);
+            doc_t::parse_ws(rd);
+            if (!rd.skip(':'))
+                doc_t::makeError(errc_t::colon, "parseMember: ':' expected", rd);
+            doc_t::parse_ws(rd);
+            if (!parse_value(rd))
+                doc_t::makeError(errc_t::value, "parseMember: 'value' expected", rd);
+        } else if (!parse_value(rd)) {
+            break;
+        }
+        count++;
+        if (!doc_t::parse_comma(rd))
+            break;
+    }
+
+    doc_t::parse_ws(rd);
+    if (!rd.skip(close))
+        doc_t::makeError(errc_t::bracket, open == '[' ? "parseArray: ']' expected" : "parseObject: '}' expected", rd);
+    doc_t::parse_ws(rd);
+
+    words.push_back(word(close, start));
+    words[start] = word(open, std::min<uint64_t>(count, count_max) << 32 | words.size());
+    return true;
+}
+
+void tape_t::serialize(FILE* f, bool const pretty) const {
+    if (!words.empty())
+        writer_t(f, pretty).write(root());
+}
+
+void tape_t::serialize(std::string& out, bool const pretty) const {
+    if (!words.empty())
+        writer_t(out, pretty).write(root());
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+#include "node.h"
+
+// read-only flat document: one array of tagged 64-bit words + side buffer for strings/numbers
+// word = tag(8) | payload(56)
+//   'n','t','f'      null, true, false
+//   '#', '"'         number, string: payload = offset in chars (uint32 length + raw text, strings keep quotes)
+//   '[', '{'         payload = index after the matching close word | count << 32 (count saturates at 0xFFFFFF)
+//   ']', '}'         payload = index of the open word
+// object members are stored as key word ('"') followed by the value words
+
+namespace json {
+
+    class tape_t {
+    public:
+        class node_t;
+
+        tape_t() = default;
+        tape_t(tape_t&&) = default;
+        tape_t(tape_t const&) = delete;
+        explicit tape_t(std::string_view const src) { parse(src); }
+
+        node_t root() const;
+        node_t find(std::string_view const path) const;
+        node_t find(jpath_t::plan_t const& plan) const;
+
+        template <typename T> std::vector<T> get_array(std::string_view const path, bool const _explicit = true) const;
+
+        // pretty (tabs) or compact text through writer_t, like doc_t::serialize
+        void serialize(FILE* f, bool const pretty = true) const;
+        void serialize(std::string& out, bool const pretty = true) const;
+
+        size_t size() const { return words.size(); }
+        size_t memory() const { return sizeof(tape_t) + words.capacity() * sizeof(uint64_t) + chars.capacity(); }
+
+    private:
+        static constexpr uint64_t payload_mask = (1ull << 56) - 1;
+        static constexpr uint32_t count_max = 0xFFFFFF;
+
+        static uint64_t word(char const tag, uint64_t const payload = 0) { return static_cast<uint64_t>(static_cast<uint8_t>(tag)) << 56 | (payload & payload_mask); }
+        char tag(size_t const i) const { return static_cast<char>(words[i] >> 56); }
+        uint64_t payload(size_t const i) const { return words[i] & payload_mask; }
+        size_t next(size_t const i) const { return tag(i) == '[' || tag(i) == '{' ? static_cast<uint32_t>(payload(i)) : i + 1; }
+        size_t count(size_t const i) const { return static_cast<size_t>(payload(i) >> 32); }
+        std::string_view text(size_t const i) const;
+
+        void parse(std::string_view const src);
+        bool parse_value(reader_t& rd);
+        bool parse_container(reader_t& rd, char const open, char const close);
+        void push_text(char const tag, std::string_view const s);
+
+    private:
+        std::vector<uint64_t> words;
+        std::string chars;
+    };
+
+    class tape_t::node_t : public node_query_t<tape_t::node_t> {
+    public:
+        class const_iterator {
+        public:
+            const_iterator(tape_t const* t, size_t const i, bool const members) : tape(t), idx(i), object(members) {}
+            node_t operator * () const { return node_t(tape, object ? idx + 1 : idx); }
+            const_iterator& operator ++ () { idx = tape->next(object ? idx + 1 : idx); return *this; }
+            bool operator != (const_iterator const& it) const { return idx != it.idx; }
+            bool operator == (const_iterator const& it) const { return idx == it.idx; }
+            std::string_view name() const { auto r = tape->text(idx); return r.size() >= 2 ? r.substr(1, r.size() - 2) : std::string_view(); }
+
+        private:
+            tape_t const* tape;
+            size_t idx;
+            bool object;
+        };
+
+    public:
+        node_t() = default;
+
+        explicit operator bool() const { return tape != nullptr; }
+        node_t const& operator * () const { return *this; }
+
+        bool is_null() const { return tag() == 'n'; }
+        bool is_bool() const { return tag() == 't' || tag() == 'f'; }
+        bool is_number() const { return tag() == '#'; }
+        bool is_string() const { return tag() == '\"'; }
+        bool is_object() const { return tag() == '{'; }
+        bool is_array() const { return tag() == '['; }
+
+        size_t size() const;
+        std::string_view get_raw_str() const;
+
+        template <typename T> T get(T const def = T()) const;
+
+        const_iterator begin() const { return const_iterator(tape, idx + 1, is_object()); }
+        const_iterator end() const { return const_iterator(tape, tape->next(idx) - 1, is_object()); }
+
+        using node_query_t<node_t>::operator (); // int, recs, range
+        node_t operator () (size_t const i) const;
+        node_t operator () (std::string_view const name) const;
+
+    private:
+        friend class tape_t;
+        node_t(tape_t const* t, size_t const i) : tape(t), idx(i) {}
+
+        char tag() const { return tape->tag(idx); }
+
+    private:
+        tape_t const* tape{ nullptr };
+        size_t idx{ 0 };
+    };
+
+    inline tape_t::node_t tape_t::root() const { return words.empty() ? node_t() : node_t(this, 0); }
+    inline tape_t::node_t tape_t::find(std::string_view const path) const { return jpath_t::walk(root(), path); }
+    inline tape_t::node_t tape_t::find(jpath_t::plan_t const& plan) const { return jpath_t::run(root(), plan); }
+
+    inline std::string_view tape_t::text(size_t const i) const {
+        size_t const ofs = static_cast<size_t>(payload(i));
+        uint32_t len;
+        memcpy(&len, chars.data() + ofs, sizeof(len));
+        return std::string_view(chars.data() + ofs + sizeof(len), len);
+    }
+
+    inline size_t tape_t::node_t::size() const {
+        if (is_array() || is_object()) {
+            if (size_t const n = tape->count(idx); n < count_max)
+                return n;
+            size_t n = 0; // saturated count
+            for (auto it = begin(); it != end(); ++it, n++);
+            return n;
+        }
+        return 0;
+    }
+
+    inline std::string_view tape_t::node_t::get_raw_str() const {
+        switch (tag()) {
+        case 'n': return "null";
+        case 't': return "true";
+        case 'f': return "false";
+        case '#': case '\"': return tape->text(idx);
+        }
+        return {};
+    }
+
+    template <typename T> T tape_t::node_t::get(T const def) const {
+        if constexpr (std::is_same_v<T, bool>)
+            return is_bool() ? tag() == 't' : def;
+        else if constexpr (std::is_same_v<T, std::string_view>) {
+            auto const src = get_raw_str();
+            return is_string() && src.size() >= 2 ? src.substr(1, src.size() - 2) : def;
+        } else if constexpr (std::is_arithmetic_v<T>)
+            return is_number() ? number<T>(get_raw_str(), def) : def;
+        else
+            return T(*this);
+    }
+
+    inline tape_t::node_t tape_t::node_t::operator () (size_t const i) const {
+        if (!is_array())
+            return node_t();
+        size_t n = 0;
+        for (auto it = begin(); it != end(); ++it, n++)
+            if (n == i) return *it;
+        return node_t();
+    }
+
+    inline tape_t::node_t tape_t::node_t::operator () (std::string_view const name) const {
+        if (is_object()) {
+            for (auto it = begin(); it != end(); ++it)
+                if (it.name() == name)
+                    return *it;
+        } else if (is_array()) {
+            for (auto const v : *this) {
+                if (v.is_object())
+                    return v(name);
+            }
+        }
+        return node_t();
+    }
+
+    template <typename T> std::vector<T> tape_t::get_array(std::string_view const path, bool const _explicit) const {
+        return find(path).template get_array<T>(_explicit);
+    }
+
+}
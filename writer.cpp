@@ -0,0 +1,135 @@
+#include "writer.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace json;
+
+namespace {
+
+    constexpr char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+    bool write_fd(int const fd, char const* data, size_t size) {
+        while (size) {
+#ifdef _WIN32
+            int const n = _write(fd, data, static_cast<unsigned>(std::min<size_t>(size, 1u << 30)));
+#else
+            ssize_t const n = ::write(fd, data, size);
+#endif
+            if (n <= 0)
+                return false;
+            data += n;
+            size -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+}
+
+bool writer_t::flush() {
+    if (!buffered()) {
+        buf.resize(len);
+        return true;
+    }
+    if (len && !bad)
+        bad = file ? fwrite(buf.data(), 1, len, file) != len : !write_fd(fd, buf.data(), len);
+    len = 0;
+    return !bad;
+}
+
+void writer_t::grow(size_t const n) {
+    buf.resize(std::max(len + n, std::max(buf.size() * 2, buffer_size * 2)));
+}
+
+writer_t& writer_t::string(std::string_view const s) {
+    put('\"');
+    escape(s, [this](std::string_view const run) { put(run); });
+    put('\"');
+    spill();
+    return *this;
+}
+
+void writer_t::indent(size_t depth) {
+    for (; depth > tabs_max; depth -= tabs_max)
+        put(std::string_view(tabs, tabs_max));
+    put(std::string_view(tabs, depth));
+}
+
+void writer_t::value(value_t const& v, size_t const depth, bool const skipIndent) {
+    if (pretty && !skipIndent)
+        indent(depth);
+    if (auto const* obj = v.get_if_object())
+        object(*obj, depth);
+    else if (auto const* arr = v.get_if_array())
+        array(*arr, depth);
+    else if (v.is_number() && v.get_raw_str().empty())
+        number(v);
+    else
+        put(v.get_raw_str());
+    spill();
+}
+
+void writer_t::number(value_t const& v) {
+    room(number_chars);
+    char* const out = &buf[len];
+    len += std::visit([out](auto const& x) -> size_t {
+        using T = std::decay_t<decltype(x)>;
+        if constexpr (std::is_same_v<T, int64_t> || std::is_same_v<T, uint64_t> || std::is_same_v<T, double>)
+            return static_cast<size_t>(format(x, out) - out);
+        else
+            return 0;
+    }, v.data());
+}
+
+void writer_t::object(object_t const& obj, size_t const depth) {
+    put('{');
+    if (!obj.size()) {
+        put('}');
+        return;
+    }
+    if (pretty)
+        put('\n');
+    for (size_t i = 0; i < obj.size(); i++) {
+        if (i)
+            put(pretty ? std::string_view(",\n") : std::string_view(","));
+        if (pretty)
+            indent(depth + 1);
+        put(obj[i].get_raw_name());
+        put(pretty ? std::string_view(": ") : std::string_view(":"));
+        value(obj[i].get_value(), depth + 1, true);
+    }
+    if (pretty) {
+        put('\n');
+        indent(depth);
+    }
+    put('}');
+}
+
+void writer_t::array(array_t const& arr, size_t const depth) {
+    put('[');
+    if (!arr.size()) {
+        put(']');
+        return;
+    }
+
+    // pretty: an array of one scalar type stays on a single line
+    bool inlined = !pretty || (!arr[0].is_object() && !arr[0].is_array());
+    for (size_t i = 1; pretty && inlined && i < arr.size(); i++)
+        inlined = arr[i].get_type() == arr[0].get_type();
+
+    if (!inlined)
+        put('\n');
+    for (size_t i = 0; i < arr.size(); i++) {
+        if (i)
+            put(inlined ? std::string_view(",") : std::string_view(",\n"));
+        value(arr[i], depth + 1, inlined);
+    }
+    if (!inlined) {
+        put('\n');
+        indent(depth);
+    }
+    put(']');
+}
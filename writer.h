@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "json.h"
+
+// buffered serializer: tokens are appended to one buffer that goes to the sink in large blocks
+// - sinks: std::string (written in place, no extra copy), FILE* (fwrite), file descriptor (write)
+// - pretty prints like doc_t::serialize always did (tabs, arrays of one scalar type on a single line),
+//   indentation is a slice of a precomputed tab table; compact emits no whitespace at all
+// - strings and numbers are copied from their source text as is, nothing is re-escaped or re-formatted;
+//   string() escapes text that doesn't come from json straight into the buffer, numbers without text
+//   (value_t::set<T>) are formatted in place by json::format
+// - a writer can be reused for any number of values, the buffer keeps its capacity
+// - read-only node types (tape_t::node_t, bjson_t::node_t) are written by the same rules from their raw text
+
+namespace json {
+
+    class writer_t {
+    public:
+        static constexpr size_t buffer_size = 1 << 16;
+
+        explicit writer_t(std::string& out, bool const _pretty = true) : buf{ out }, len{ out.size() }, pretty{ _pretty } {}
+        explicit writer_t(FILE* const f, bool const _pretty = true) : buf{ own }, file{ f }, pretty{ _pretty } {}
+        explicit writer_t(int const _fd, bool const _pretty = true) : buf{ own }, fd{ _fd }, pretty{ _pretty } {}
+        writer_t(writer_t const&) = delete;
+        ~writer_t() { flush(); }
+
+        writer_t& write(value_t const& v) { value(v, 0, false); return *this; }
+        template <typename N> writer_t& write(N const& n) { node(n, 0, false); return *this; }
+        writer_t& string(std::string_view const s); // plain text as a json string: quoted, escaped in place
+        bool flush(); // hands the buffer to FILE*/fd (std::string: trims it to the text), false once the sink failed
+
+    private:
+        static constexpr size_t tabs_max = 32;
+
+        bool buffered() const { return file || fd >= 0; }
+        // the buffer is grown ahead and written through memcpy, its size is only fixed up by flush()
+        void room(size_t const n) { if (len + n > buf.size()) grow(n); }
+        void put(char const ch) { room(1); buf[len++] = ch; }
+        void put(std::string_view const s) { room(s.size()); memcpy(&buf[len], s.data(), s.size()); len += s.size(); }
+        void grow(size_t const n);
+        void indent(size_t depth);
+        void spill() { if (buffered() && len >= buffer_size) flush(); }
+
+        void value(value_t const& v, size_t const depth, bool const skipIndent);
+        void number(value_t const& v); // set<T>() number, no source text
+        void object(object_t const& obj, size_t const depth);
+        void array(array_t const& arr, size_t const depth);
+        template <typename N> void node(N const& n, size_t const depth, bool const skipIndent);
+
+    private:
+        std::string own;
+        std::string& buf;
+        size_t len{ 0 }; // text in buf
+        FILE* file{ nullptr };
+        int fd{ -1 };
+        bool pretty;
+        bool bad{ false };
+    };
+
+    template <typename N> void writer_t::node(N const& n, size_t const depth, bool const skipIndent) {
+        if (pretty && !skipIndent)
+            indent(depth);
+        if (n.is_object() && n.begin() != n.end()) {
+            put(pretty ? std::string_view("{\n") : std::string_view("{"));
+            for (auto it = n.begin(); it != n.end(); ++it) {
+                if (it != n.begin())
+                    put(pretty ? std::string_view(",\n") : std::string_view(","));
+                if (pretty)
+                    indent(depth + 1);
+                put('\"');
+                put(it.name());
+                put(pretty ? std::string_view("\": ") : std::string_view("\":"));
+                node(*it, depth + 1, true);
+            }
+            if (pretty) {
+                put('\n');
+                indent(depth);
+            }
+            put('}');
+        } else if (n.is_array() && n.begin() != n.end()) {
+            // pretty: an array of one scalar type stays on a single line
+            auto const kind = [](N const& e) { return e.is_object() ? 0 : e.is_array() ? 1 : e.is_string() ? 2 : e.is_number() ? 3 : e.is_bool() ? 4 : 5; };
+            int const first = kind(*n.begin());
+            bool inlined = !pretty || first > 1;
+            for (auto it = n.begin(); pretty && inlined && it != n.end(); ++it)
+                inlined = kind(*it) == first;
+
+            put(inlined ? std::string_view("[") : std::string_view("[\n"));
+            for (auto it = n.begin(); it != n.end(); ++it) {
+                if (it != n.begin())
+                    put(inlined ? std::string_view(",") : std::string_view(",\n"));
+                node(*it, depth + 1, inlined);
+            }
+            if (!inlined) {
+                put('\n');
+                indent(depth);
+            }
+            put(']');
+        } else if (n.is_object() || n.is_array()) {
+            put(n.is_object() ? std::string_view("{}") : std::string_view("[]"));
+        } else {
+            put(n.get_raw_str());
+        }
+        spill();
+    }
+
+}